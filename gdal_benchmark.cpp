@@ -0,0 +1,636 @@
+/* ========================================================================
+    File: @(#)gdal_benchmark.cpp
+   ------------------------------------------------------------------------
+    gdal_benchmark - runs the gdal-tools on synthetic geo-referenced
+                     rasters and reports time and memory per phase
+    Copyright (C) 2014-2015 Christoph Hormann <chris_hormann@gmx.de>
+   ------------------------------------------------------------------------
+
+    This file is part of gdal-tools
+
+    gdal-tools is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gdal-tools is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gdal-tools.  If not, see <http://www.gnu.org/licenses/>.
+
+    Version history:
+
+      0.1: initial version, October 2026
+
+   ========================================================================
+ */
+
+const char PROGRAM_TITLE[] = "gdal_benchmark 0.1";
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include <gdal_priv.h>
+#include <ogr_spatialref.h>
+#include <cpl_conv.h>
+
+// projections of the test data, the height of geographic images is half
+// their width
+struct BenchProjection
+{
+	const char *Name;
+	int Epsg;
+	double X1, Y1, X2, Y2;
+	bool WebMercator;
+};
+
+static const BenchProjection Projections[] =
+{
+	{ "3857", 3857, -20037508.342789244, -20037508.342789244, 20037508.342789244, 20037508.342789244, true },
+	{ "4326", 4326, -180.0, -85.0, 180.0, 85.0, false },
+	{ "laea", 3035, 2500000.0, 1000000.0, 7500000.0, 6000000.0, false },
+	{ "stere", 3413, -4000000.0, -4000000.0, 4000000.0, 4000000.0, false },
+};
+
+static const char *Tools[] =
+{
+	"gdal_valscale", "gdal_maskbuffer", "gdal_maskbuffer_wm", "gdal_maskcompare", "gdal_maskcompare_wm"
+};
+
+// ---------------------------------------------------------------------------
+// synthetic data
+
+// value in [-1,1] at an integer lattice point
+static double lattice(unsigned int seed, int ix, int iy)
+{
+	unsigned int h = seed*2654435761u ^ (unsigned int)(ix)*374761393u ^ (unsigned int)(iy)*668265263u;
+	h = (h ^ (h >> 13))*1274126177u;
+	h ^= h >> 16;
+	return (h & 0xffffff)/double(0xffffff)*2.0 - 1.0;
+}
+
+// smoothly interpolated value noise
+static double noise(unsigned int seed, double x, double y)
+{
+	int ix = int(std::floor(x));
+	int iy = int(std::floor(y));
+	double fx = x - ix;
+	double fy = y - iy;
+	fx = fx*fx*(3.0-2.0*fx);
+	fy = fy*fy*(3.0-2.0*fy);
+	double v0 = lattice(seed, ix, iy) + fx*(lattice(seed, ix+1, iy) - lattice(seed, ix, iy));
+	double v1 = lattice(seed, ix, iy+1) + fx*(lattice(seed, ix+1, iy+1) - lattice(seed, ix, iy+1));
+	return v0 + fy*(v1-v0);
+}
+
+// fractal noise with octaves down to the pixel size, thresholding it gives
+// coastline like edges with detail at all scales
+static double fractal(unsigned int seed, double u, double v, int octaves)
+{
+	double sum = 0.0;
+	double amp = 0.5;
+	double freq = 4.0;
+	for (int o = 0; o < octaves; o++)
+	{
+		sum += amp*noise(seed+o, u*freq, v*freq);
+		amp *= 0.5;
+		freq *= 2.0;
+	}
+	return sum;
+}
+
+// Creates a mask (255 land, 0 water), a candidate mask with the coastline
+// moved slightly and isolated pixels changed, and a Float32 density raster
+// with nodata on water.  Rows are generated in parallel in strips.
+static bool generate(const BenchProjection &proj, int nXSize, int nYSize,
+                     const std::string &fnm_mask, const std::string &fnm_cand, const std::string &fnm_density)
+{
+	GDALDriver *poDriver = GetGDALDriverManager()->GetDriverByName("GTiff");
+	if (poDriver == NULL)
+		return false;
+
+	char **options = NULL;
+	options = CSLAddString(options, "TILED=YES");
+	options = CSLAddString(options, "BIGTIFF=IF_SAFER");
+
+	GDALDataset *poMask = poDriver->Create(fnm_mask.c_str(), nXSize, nYSize, 1, GDT_Byte, options);
+	GDALDataset *poCand = poDriver->Create(fnm_cand.c_str(), nXSize, nYSize, 1, GDT_Byte, options);
+	GDALDataset *poDensity = poDriver->Create(fnm_density.c_str(), nXSize, nYSize, 1, GDT_Float32, options);
+	CSLDestroy(options);
+
+	if ((poMask == NULL) || (poCand == NULL) || (poDensity == NULL))
+		return false;
+
+	double adfGeoTransform[6] = { proj.X1, (proj.X2-proj.X1)/nXSize, 0.0, proj.Y2, 0.0, -(proj.Y2-proj.Y1)/nYSize };
+
+	OGRSpatialReference oSRS;
+	char *wkt = NULL;
+	if ((oSRS.importFromEPSG(proj.Epsg) != OGRERR_NONE) || (oSRS.exportToWkt(&wkt) != OGRERR_NONE))
+		return false;
+
+	GDALDataset *datasets[3] = { poMask, poCand, poDensity };
+	for (int i = 0; i < 3; i++)
+	{
+		datasets[i]->SetGeoTransform(adfGeoTransform);
+		datasets[i]->SetProjection(wkt);
+	}
+	CPLFree(wkt);
+
+	poDensity->GetRasterBand(1)->SetNoDataValue(-1.0);
+
+	int octaves = std::max(1, std::min(16, int(std::log2(std::max(nXSize, nYSize)/4.0))));
+	double scale = 1.0/std::max(nXSize, nYSize);
+	int nThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	const int nStripRows = 256;
+	std::vector<unsigned char> mask(size_t(nXSize)*nStripRows);
+	std::vector<unsigned char> cand(size_t(nXSize)*nStripRows);
+	std::vector<float> density(size_t(nXSize)*nStripRows);
+
+	bool ok = true;
+	for (int y0 = 0; (y0 < nYSize) && ok; y0 += nStripRows)
+	{
+		int nRows = std::min(nStripRows, nYSize-y0);
+		std::atomic<int> next_row(0);
+
+		std::vector<std::thread> threads;
+		for (int i = 0; i < nThreads; i++)
+		{
+			threads.push_back(std::thread([&]()
+			{
+				int r;
+				while ((r = next_row++) < nRows)
+				{
+					int py = y0+r;
+					for (int px = 0; px < nXSize; px++)
+					{
+						size_t i = size_t(r)*nXSize + px;
+						double f = fractal(1, px*scale, py*scale, octaves);
+						bool land = (f > 0.05);
+						bool land_cand = (f > 0.05 + 0.01*noise(7, px*scale*16.0, py*scale*16.0));
+						if (lattice(11, px, py) > 0.99998)
+							land_cand = !land_cand;
+						mask[i] = land ? 255 : 0;
+						cand[i] = land_cand ? 255 : 0;
+						density[i] = land ? float(std::exp(3.0*fractal(3, px*scale, py*scale, octaves))) : -1.0f;
+					}
+				}
+			}));
+		}
+		for (size_t i = 0; i < threads.size(); i++)
+			threads[i].join();
+
+		ok = (poMask->GetRasterBand(1)->RasterIO( GF_Write, 0, y0, nXSize, nRows, &mask[0], nXSize, nRows, GDT_Byte, 0, 0 ) == CE_None) &&
+		     (poCand->GetRasterBand(1)->RasterIO( GF_Write, 0, y0, nXSize, nRows, &cand[0], nXSize, nRows, GDT_Byte, 0, 0 ) == CE_None) &&
+		     (poDensity->GetRasterBand(1)->RasterIO( GF_Write, 0, y0, nXSize, nRows, &density[0], nXSize, nRows, GDT_Float32, 0, 0 ) == CE_None);
+	}
+
+	GDALClose(poMask);
+	GDALClose(poCand);
+	GDALClose(poDensity);
+
+	return ok;
+}
+
+// ---------------------------------------------------------------------------
+// running the tools
+
+struct Phase
+{
+	std::string Name;
+	double Seconds;
+	double CpuSeconds;
+	long PeakKB;
+};
+
+// Name of the phase starting with a line of tool output, the tools announce
+// phases with lines indented by two spaces ending in "...", details in
+// parentheses are dropped.  Returns an empty string for other lines.
+static std::string phase_name(const char *line)
+{
+	if ((std::strncmp(line, "  ", 2) != 0) || (line[2] == ' '))
+		return std::string();
+
+	std::string s(line+2);
+	while (!s.empty() && ((s.back() == '\n') || (s.back() == '\r')))
+		s.pop_back();
+	if ((s.size() < 3) || (s.compare(s.size()-3, 3, "...") != 0))
+		return std::string();
+	s.resize(s.size()-3);
+
+	size_t p = s.find(" (");
+	if (p != std::string::npos)
+		s.resize(p);
+	return s;
+}
+
+// peak resident memory of a running process so far in kB, 0 if unknown
+static long peak_rss(pid_t pid)
+{
+	char fnm[64];
+	std::snprintf(fnm, sizeof(fnm), "/proc/%d/status", int(pid));
+	FILE *f = std::fopen(fnm, "r");
+	if (f == NULL)
+		return 0;
+
+	long kb = 0;
+	char line[256];
+	while (std::fgets(line, sizeof(line), f))
+		if (std::sscanf(line, "VmHWM: %ld", &kb) == 1)
+			break;
+	std::fclose(f);
+	return kb;
+}
+
+// CPU time (user and system) of a running process so far, 0 if unknown
+static double cpu_time(pid_t pid)
+{
+	char fnm[64];
+	std::snprintf(fnm, sizeof(fnm), "/proc/%d/stat", int(pid));
+	FILE *f = std::fopen(fnm, "r");
+	if (f == NULL)
+		return 0.0;
+
+	// the command name in parentheses may contain spaces
+	char buf[1024];
+	size_t n = std::fread(buf, 1, sizeof(buf)-1, f);
+	std::fclose(f);
+	buf[n] = 0;
+	const char *p = std::strrchr(buf, ')');
+	unsigned long utime = 0, stime = 0;
+	if ((p == NULL) || (std::sscanf(p+1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2))
+		return 0.0;
+	return double(utime+stime)/sysconf(_SC_CLK_TCK);
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point t0)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// Run a tool with its standard error split into phases at the phase lines.
+// The peak memory of a phase is the peak of the process up to its end.
+// Times of the last phase are the rest of the totals.
+// Returns false if the tool could not be run or failed.
+static bool run_tool(const std::vector<std::string> &args, bool verbose,
+                     std::vector<Phase> &phases, double &seconds, double &cpu_seconds, long &peak_kb)
+{
+	int fds[2];
+	if (pipe(fds) != 0)
+		return false;
+
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+	pid_t pid = fork();
+	if (pid < 0)
+		return false;
+
+	if (pid == 0)
+	{
+		dup2(fds[1], 2);
+		close(fds[0]);
+		close(fds[1]);
+		int null = open("/dev/null", O_WRONLY);
+		if (null >= 0)
+			dup2(null, 1);
+
+		std::vector<char *> argv;
+		for (size_t i = 0; i < args.size(); i++)
+			argv.push_back(const_cast<char *>(args[i].c_str()));
+		argv.push_back(NULL);
+		execv(argv[0], &argv[0]);
+		std::fprintf(stderr, "  running %s failed.\n", argv[0]);
+		_exit(127);
+	}
+
+	close(fds[1]);
+	FILE *f = fdopen(fds[0], "r");
+
+	Phase phase = { "startup", 0.0, 0.0, 0 };
+	double phase_start = 0.0;
+	double phase_cpu = 0.0;
+	char line[4096];
+	while (std::fgets(line, sizeof(line), f))
+	{
+		if (verbose)
+			std::fputs(line, stderr);
+
+		std::string name = phase_name(line);
+		if (!name.empty())
+		{
+			double t = seconds_since(t0);
+			double cpu = cpu_time(pid);
+			phase.Seconds = t - phase_start;
+			phase.CpuSeconds = std::max(0.0, cpu - phase_cpu);
+			phase.PeakKB = peak_rss(pid);
+			phases.push_back(phase);
+			phase.Name = name;
+			phase_start = t;
+			phase_cpu = std::max(phase_cpu, cpu);
+		}
+	}
+	std::fclose(f);
+
+	int status = 0;
+	struct rusage ru;
+	wait4(pid, &status, 0, &ru);
+
+	seconds = seconds_since(t0);
+	cpu_seconds = ru.ru_utime.tv_sec + 1.0e-6*ru.ru_utime.tv_usec + ru.ru_stime.tv_sec + 1.0e-6*ru.ru_stime.tv_usec;
+	peak_kb = ru.ru_maxrss;
+
+	phase.Seconds = seconds - phase_start;
+	phase.CpuSeconds = std::max(0.0, cpu_seconds - phase_cpu);
+	phase.PeakKB = peak_kb;
+	phases.push_back(phase);
+
+	return WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+}
+
+// ---------------------------------------------------------------------------
+// report
+
+static bool json = false;
+
+static void report_header()
+{
+	if (!json)
+		std::printf("tool,projection,width,height,phase,seconds,cpu_seconds,mpixel_per_s,peak_rss_mb,status\n");
+}
+
+static void report(const char *tool, const BenchProjection &proj, int nXSize, int nYSize,
+                   const std::string &phase, double seconds, double cpu_seconds, long peak_kb, bool ok)
+{
+	double mpix = double(nXSize)*nYSize/1.0e6;
+	double rate = (seconds > 0.0) ? mpix/seconds : 0.0;
+
+	if (json)
+		std::printf("{\"tool\": \"%s\", \"projection\": \"%s\", \"width\": %d, \"height\": %d, \"phase\": \"%s\", "
+		            "\"seconds\": %.4f, \"cpu_seconds\": %.4f, \"mpixel_per_s\": %.3f, \"peak_rss_mb\": %.1f, \"status\": \"%s\"}\n",
+		            tool, proj.Name, nXSize, nYSize, phase.c_str(), seconds, cpu_seconds, rate, peak_kb/1024.0, ok ? "ok" : "failed");
+	else
+		std::printf("%s,%s,%d,%d,%s,%.4f,%.4f,%.3f,%.1f,%s\n",
+		            tool, proj.Name, nXSize, nYSize, phase.c_str(), seconds, cpu_seconds, rate, peak_kb/1024.0, ok ? "ok" : "failed");
+	std::fflush(stdout);
+}
+
+// number of pixels of the first band differing between two files, -1 if
+// they can not be read
+static long count_changed(const std::string &fnm_a, const std::string &fnm_b)
+{
+	GDALDataset *poA = (GDALDataset *) GDALOpen(fnm_a.c_str(), GA_ReadOnly);
+	GDALDataset *poB = (GDALDataset *) GDALOpen(fnm_b.c_str(), GA_ReadOnly);
+	long cnt = -1;
+
+	if ((poA != NULL) && (poB != NULL) && (poA->GetRasterXSize() == poB->GetRasterXSize()) && (poA->GetRasterYSize() == poB->GetRasterYSize()))
+	{
+		int nXSize = poA->GetRasterXSize();
+		int nYSize = poA->GetRasterYSize();
+		std::vector<unsigned char> a(nXSize), b(nXSize);
+		cnt = 0;
+		for (int y = 0; y < nYSize; y++)
+		{
+			if ((poA->GetRasterBand(1)->RasterIO(GF_Read, 0, y, nXSize, 1, &a[0], nXSize, 1, GDT_Byte, 0, 0) != CE_None) ||
+			    (poB->GetRasterBand(1)->RasterIO(GF_Read, 0, y, nXSize, 1, &b[0], nXSize, 1, GDT_Byte, 0, 0) != CE_None))
+			{
+				cnt = -1;
+				break;
+			}
+			for (int x = 0; x < nXSize; x++)
+				if (a[x] != b[x])
+					cnt++;
+		}
+	}
+
+	if (poA != NULL)
+		GDALClose(poA);
+	if (poB != NULL)
+		GDALClose(poB);
+
+	return cnt;
+}
+
+static void remove_file(const std::string &fnm)
+{
+	GDALDriver *poDriver = GetGDALDriverManager()->GetDriverByName("GTiff");
+	struct stat st;
+	if (poDriver && (stat(fnm.c_str(), &st) == 0))
+		poDriver->Delete(fnm.c_str());
+}
+
+int main(int argc,char **argv)
+{
+	std::fprintf(stderr,"%s\n", PROGRAM_TITLE);
+	std::fprintf(stderr,"-------------------------------------------------------\n");
+	std::fprintf(stderr,"Copyright (C) 2014-2015 Christoph Hormann\n");
+	std::fprintf(stderr,"This program comes with ABSOLUTELY NO WARRANTY;\n");
+	std::fprintf(stderr,"This is free software, and you are welcome to redistribute\n");
+	std::fprintf(stderr,"it under certain conditions; see COPYING for details.\n");
+
+	// options:
+	//   -s <size>: image width, can be given several times
+	//   -p <projection>: projection of the test data, can be given several times
+	//   -t <tool>: tool to run, can be given several times
+	//   -b <dir>: directory of the tools
+	//   -d <dir>: directory of the test data
+	//   -r <pixels>: buffer and comparison radius in pixels
+	//   -json: JSON lines instead of CSV
+	//   -v: show the output of the tools
+
+	std::vector<int> sizes;
+	std::vector<const BenchProjection *> projections;
+	std::vector<std::string> tools;
+	std::string bindir = ".";
+	std::string datadir = "bench";
+	double radius_px = 8.0;
+	bool verbose = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if ((std::strcmp(argv[i], "-s") == 0) && (i+1 < argc))
+		{
+			const char *s = argv[++i];
+			int size = atoi(s);
+			if ((s[0] != 0) && ((s[std::strlen(s)-1] == 'k') || (s[std::strlen(s)-1] == 'K')))
+				size *= 1024;
+			sizes.push_back(std::max(16, size));
+		}
+		else if ((std::strcmp(argv[i], "-p") == 0) && (i+1 < argc))
+		{
+			const char *name = argv[++i];
+			const BenchProjection *proj = NULL;
+			for (size_t k = 0; k < sizeof(Projections)/sizeof(Projections[0]); k++)
+				if (std::strcmp(Projections[k].Name, name) == 0)
+					proj = &Projections[k];
+			if (proj == NULL)
+			{
+				std::fprintf(stderr,"  unknown projection %s.\n\n", name);
+				std::exit(1);
+			}
+			projections.push_back(proj);
+		}
+		else if ((std::strcmp(argv[i], "-t") == 0) && (i+1 < argc))
+			tools.push_back(argv[++i]);
+		else if ((std::strcmp(argv[i], "-b") == 0) && (i+1 < argc))
+			bindir = argv[++i];
+		else if ((std::strcmp(argv[i], "-d") == 0) && (i+1 < argc))
+			datadir = argv[++i];
+		else if ((std::strcmp(argv[i], "-r") == 0) && (i+1 < argc))
+			radius_px = std::max(1.0, atof(argv[++i]));
+		else if (std::strcmp(argv[i], "-json") == 0)
+			json = true;
+		else if (std::strcmp(argv[i], "-v") == 0)
+			verbose = true;
+		else
+		{
+			std::fprintf(stderr,"  runs the tools on synthetic data and reports time and memory per phase\n");
+			std::fprintf(stderr,"  options:\n");
+			std::fprintf(stderr,"    -s <size>       image width like 1024 or 16k, can be repeated (default: 1k and 4k)\n");
+			std::fprintf(stderr,"    -p <proj>       projection (3857, 4326, laea, stere), can be repeated (default: all)\n");
+			std::fprintf(stderr,"    -t <tool>       tool to run, can be repeated (default: all)\n");
+			std::fprintf(stderr,"    -b <dir>        directory of the tools (default: .)\n");
+			std::fprintf(stderr,"    -d <dir>        directory of the test data (default: bench)\n");
+			std::fprintf(stderr,"    -r <pixels>     buffer and comparison radius in pixels (default: 8)\n");
+			std::fprintf(stderr,"    -json           write JSON lines instead of CSV\n");
+			std::fprintf(stderr,"    -v              show the output of the tools\n\n");
+			std::exit(1);
+		}
+	}
+
+	if (sizes.empty())
+	{
+		sizes.push_back(1024);
+		sizes.push_back(4096);
+	}
+	if (projections.empty())
+		for (size_t k = 0; k < sizeof(Projections)/sizeof(Projections[0]); k++)
+			projections.push_back(&Projections[k]);
+	if (tools.empty())
+		tools.assign(Tools, Tools + sizeof(Tools)/sizeof(Tools[0]));
+
+	GDALAllRegister();
+
+	mkdir(datadir.c_str(), 0777);
+
+	report_header();
+
+	for (size_t si = 0; si < sizes.size(); si++)
+		for (size_t pi = 0; pi < projections.size(); pi++)
+		{
+			const BenchProjection &proj = *projections[pi];
+			int nXSize = sizes[si];
+			int nYSize = (proj.Epsg == 4326) ? nXSize/2 : nXSize;
+
+			// the test data is kept and only generated if missing
+			std::string base = datadir + "/" + proj.Name + "_" + std::to_string(nXSize);
+			std::string fnm_mask = base + "_mask.tif";
+			std::string fnm_cand = base + "_cand.tif";
+			std::string fnm_density = base + "_density.tif";
+			std::string fnm_out = base + "_out.tif";
+
+			struct stat st;
+			if ((stat(fnm_mask.c_str(), &st) != 0) || (stat(fnm_cand.c_str(), &st) != 0) || (stat(fnm_density.c_str(), &st) != 0))
+			{
+				std::fprintf(stderr,"  generating test data %s (%dx%d)...\n", base.c_str(), nXSize, nYSize);
+				std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+				bool ok = generate(proj, nXSize, nYSize, fnm_mask, fnm_cand, fnm_density);
+				struct rusage ru;
+				getrusage(RUSAGE_SELF, &ru);
+				report("generate", proj, nXSize, nYSize, "total", seconds_since(t0), 0.0, ru.ru_maxrss, ok);
+				if (!ok)
+				{
+					std::fprintf(stderr,"  generating test data failed.\n\n");
+					std::exit(1);
+				}
+			}
+
+			// the tools take the radius in meters, for geographic data the
+			// pixel size is converted at the equator
+			double pixel_size = (proj.X2-proj.X1)/nXSize;
+			if (proj.Epsg == 4326)
+				pixel_size *= M_PI/180.0*6378137.0;
+			char radius[32];
+			std::snprintf(radius, sizeof(radius), "%.6g", radius_px*pixel_size);
+
+			for (size_t ti = 0; ti < tools.size(); ti++)
+			{
+				const std::string &tool = tools[ti];
+				bool wm = (tool.size() > 3) && (tool.compare(tool.size()-3, 3, "_wm") == 0);
+				if (wm && !proj.WebMercator)
+					continue;
+
+				std::vector<std::string> args;
+				args.push_back(bindir + "/" + tool);
+				if (tool == "gdal_valscale")
+				{
+					args.push_back("-o");
+					args.push_back(fnm_out);
+					args.push_back(fnm_density);
+				}
+				else if ((tool == "gdal_maskbuffer") || (tool == "gdal_maskbuffer_wm"))
+				{
+					args.push_back("-T");
+					args.push_back("1024");
+					args.push_back("-o");
+					args.push_back(fnm_out);
+					args.push_back(fnm_mask);
+					args.push_back(radius);
+				}
+				else if ((tool == "gdal_maskcompare") || (tool == "gdal_maskcompare_wm"))
+				{
+					args.push_back(fnm_mask);
+					args.push_back(fnm_cand);
+					args.push_back(radius);
+				}
+				else
+				{
+					std::fprintf(stderr,"  unknown tool %s.\n\n", tool.c_str());
+					std::exit(1);
+				}
+
+				std::fprintf(stderr,"  running %s on %s...\n", tool.c_str(), base.c_str());
+
+				std::vector<Phase> phases;
+				double seconds = 0.0, cpu_seconds = 0.0;
+				long peak_kb = 0;
+				bool ok = run_tool(args, verbose, phases, seconds, cpu_seconds, peak_kb);
+
+				// a buffer that does not change anything is not a valid measurement
+				if (ok && (tool.compare(0, 15, "gdal_maskbuffer") == 0))
+				{
+					long cnt = count_changed(fnm_mask, fnm_out);
+					if (cnt <= 0)
+					{
+						std::fprintf(stderr,"    %s did not change any pixels.\n", tool.c_str());
+						ok = false;
+					}
+				}
+
+				for (size_t k = 0; k < phases.size(); k++)
+					report(tool.c_str(), proj, nXSize, nYSize, phases[k].Name, phases[k].Seconds, phases[k].CpuSeconds, phases[k].PeakKB, ok);
+				report(tool.c_str(), proj, nXSize, nYSize, "total", seconds, cpu_seconds, peak_kb, ok);
+
+				if (!ok)
+					std::fprintf(stderr,"    %s failed.\n", tool.c_str());
+
+				remove_file(fnm_out);
+			}
+		}
+}
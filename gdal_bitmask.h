@@ -0,0 +1,295 @@
+/* ========================================================================
+    File: @(#)gdal_bitmask.h
+   ------------------------------------------------------------------------
+    bit packed black/white masks for the gdal-tools
+    Copyright (C) 2014-2015 Christoph Hormann <chris_hormann@gmx.de>
+   ------------------------------------------------------------------------
+
+    This file is part of gdal-tools
+
+    gdal-tools is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gdal-tools is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gdal-tools.  If not, see <http://www.gnu.org/licenses/>.
+
+   ========================================================================
+ */
+
+#ifndef GDAL_BITMASK_H
+#define GDAL_BITMASK_H
+
+#include <cstddef>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+#include <gdal_priv.h>
+
+#include "gdal_iothread.h"
+#include "gdal_profile.h"
+
+// Mask with one bit per pixel, rows are padded to whole 64 bit words with
+// the bit of pixel x in word x/64 at position x%64.  Padding bits are always
+// zero so whole words of two masks can be compared and counted.
+class BitMask
+{
+public:
+	typedef unsigned long long Word;
+	enum { WordBits = 64 };
+
+	BitMask(): W(0), H(0), Words(0) {}
+	BitMask(int w, int h) { resize(w, h); }
+
+	// resize to w x h with all bits cleared
+	void resize(int w, int h)
+	{
+		W = w;
+		H = h;
+		Words = (w+WordBits-1)/WordBits;
+		Bits.assign(Words*h, 0);
+	}
+
+	int width() const { return W; }
+	int height() const { return H; }
+	size_t words() const { return Words; }
+	size_t bytes() const { return Bits.size()*sizeof(Word); }
+
+	Word *row(int y) { return &Bits[size_t(y)*Words]; }
+	const Word *row(int y) const { return &Bits[size_t(y)*Words]; }
+
+	bool get(int x, int y) const { return (row(y)[x/WordBits] >> (x%WordBits)) & 1; }
+	void set(int x, int y) { row(y)[x/WordBits] |= Word(1) << (x%WordBits); }
+
+	// view of the region starting at x0,y0 for the distance transforms
+	struct View
+	{
+		bool operator()(int x, int y) const
+		{
+			x += X0;
+			return (Bits[size_t(Y0+y)*Words + x/WordBits] >> (x%WordBits)) & 1;
+		}
+
+		const Word *Bits;
+		size_t Words;
+		int X0, Y0;
+	};
+
+	View view(int x0 = 0, int y0 = 0) const
+	{
+		View v = { Bits.data(), Words, x0, y0 };
+		return v;
+	}
+
+	// number of set bits
+	size_t count() const
+	{
+		size_t cnt = 0;
+		for (size_t i = 0; i < Bits.size(); i++)
+			cnt += __builtin_popcountll(Bits[i]);
+		return cnt;
+	}
+
+	// set the bits of row y from n >= width() bytes, pixels of value val are set
+	void pack_row(int y, const unsigned char *src, unsigned char val)
+	{
+		Word *r = row(y);
+		for (size_t i = 0; i < Words; i++)
+		{
+			int x0 = i*WordBits;
+			int n = std::min<int>(WordBits, W-x0);
+			Word w = 0;
+			for (int b = 0; b < n; b++)
+				w |= Word(src[x0+b] == val) << b;
+			r[i] = w;
+		}
+	}
+
+	// pixels [x1,x2) of row y as bytes, on for set bits, off otherwise
+	void unpack_row(int y, int x1, int x2, unsigned char *dst, unsigned char on, unsigned char off) const
+	{
+		const Word *r = row(y);
+		for (int x = x1; x < x2; x++)
+			dst[x-x1] = ((r[x/WordBits] >> (x%WordBits)) & 1) ? on : off;
+	}
+
+	// bits of word i of a row for the pixels [x1,x2)
+	static Word range(int i, int x1, int x2)
+	{
+		Word m = ~Word(0);
+		if (i*WordBits < x1)
+			m &= ~Word(0) << (x1 - i*WordBits);
+		if ((i+1)*WordBits > x2)
+			m &= (x2 > i*WordBits) ? ~Word(0) >> (WordBits - (x2 - i*WordBits)) : 0;
+		return m;
+	}
+
+	// true if pixels [x1,x2) of row y differ from the same row of other,
+	// whole words are compared with a single XOR
+	bool differs(const BitMask &other, int y, int x1, int x2) const
+	{
+		if (x1 >= x2)
+			return false;
+
+		const Word *a = row(y);
+		const Word *b = other.row(y);
+		for (int i = x1/WordBits; i <= (x2-1)/WordBits; i++)
+			if ((a[i] ^ b[i]) & range(i, x1, x2))
+				return true;
+		return false;
+	}
+
+	// mask value val of 0 or 255 as stored in a band, NBITS=1 files have the
+	// values 0 and 1 so 255 is 1 there
+	static unsigned char band_value(GDALRasterBand *poBand, unsigned char val)
+	{
+		const char *nbits = poBand->GetMetadataItem("NBITS", "IMAGE_STRUCTURE");
+		if (nbits && (std::atoi(nbits) == 1) && (val == 255))
+			return 1;
+		return val;
+	}
+
+	// rows per read of a band, whole blocks and at least 64 rows
+	static int strip_rows(GDALRasterBand *poBand, int nYSize)
+	{
+		int nBlockXSize, nBlockYSize;
+		poBand->GetBlockSize(&nBlockXSize, &nBlockYSize);
+		nBlockYSize = std::max(1, nBlockYSize);
+		return std::max(1, std::min(nYSize, nBlockYSize*((WordBits+nBlockYSize-1)/nBlockYSize)));
+	}
+
+	// Read a band as mask, pixels of value val (see band_value()) are set.
+	// The data is read as GDT_Byte in strips and packed strip by strip so only
+	// the bit mask is held in memory, the next strip is read in the background
+	// while one is packed.  Returns false if reading fails.
+	bool read(GDALRasterBand *poBand, int nXSize, int nYSize, unsigned char val)
+	{
+		resize(nXSize, nYSize);
+		return read_rows(poBand, 0, nYSize, 0, val);
+	}
+
+	// Read rows [y0,y0+h) of a band of the mask width into rows [dy,dy+h) of
+	// the mask like read().
+	bool read_rows(GDALRasterBand *poBand, int y0, int h, int dy, unsigned char val)
+	{
+		val = band_value(poBand, val);
+		int rows = strip_rows(poBand, h);
+		std::vector<unsigned char> strips[2];
+		strips[0].resize(size_t(W)*rows);
+		if (h > rows)
+			strips[1].resize(size_t(W)*rows);
+
+		IOThread reader;
+		const int w = W;
+		auto read = [&](int y)
+		{
+			int n = std::min(rows, h-y);
+			unsigned char *strip = &strips[(y/rows) % 2][0];
+			return reader.start([=]()
+			{
+				if (poBand->RasterIO( GF_Read, 0, y0+y, w, n, strip, w, n, GDT_Byte, 0, 0 ) != CE_None)
+					return false;
+				profile().read(size_t(w)*n);
+				return true;
+			});
+		};
+
+		if ((h > 0) && !read(0))
+			return false;
+
+		for (int y = 0; y < h; y += rows)
+		{
+			if (!reader.wait())
+				return false;
+			if ((y+rows < h) && !read(y+rows))
+				return false;
+
+			int n = std::min(rows, h-y);
+			const unsigned char *strip = &strips[(y/rows) % 2][0];
+			for (int i = 0; i < n; i++)
+				pack_row(dy+y+i, &strip[size_t(i)*W], val);
+		}
+
+		return true;
+	}
+
+	// copy n rows starting at row sy of another mask of the same width to row dy
+	void copy_rows(const BitMask &src, int sy, int dy, int n)
+	{
+		if (n > 0)
+			std::memcpy(row(dy), src.row(sy), size_t(n)*Words*sizeof(Word));
+	}
+
+	// move n rows starting at row src to row dst
+	void move_rows(int src, int dst, int n)
+	{
+		if ((n > 0) && (src != dst))
+			std::memmove(row(dst), row(src), size_t(n)*Words*sizeof(Word));
+	}
+
+	// Set the pixels of the set bits to val (see band_value()) in rows
+	// [y0,y0+height()) of a band of the mask width.  Only strips containing
+	// set bits are read, modified and written back so all other pixels keep
+	// their values.  With a separate source band all strips are read from
+	// the source and written to the band, val is then encoded like in the
+	// source.  Returns false if reading or writing fails.
+	bool write_set(GDALRasterBand *poBand, unsigned char val, int y0 = 0, GDALRasterBand *poSrcBand = NULL) const
+	{
+		if (poSrcBand == NULL)
+			poSrcBand = poBand;
+		val = band_value(poSrcBand, val);
+		int rows = strip_rows(poBand, H);
+		std::vector<unsigned char> strip(size_t(W)*rows);
+
+		for (int sy = 0; sy < H; sy += rows)
+		{
+			int h = std::min(rows, H-sy);
+
+			bool any = (poSrcBand != poBand);
+			for (size_t i = size_t(sy)*Words; (i < size_t(sy+h)*Words) && !any; i++)
+				any = (Bits[i] != 0);
+			if (!any)
+				continue;
+
+			if( poSrcBand->RasterIO( GF_Read, 0, y0+sy, W, h, &strip[0], W, h, GDT_Byte, 0, 0 ) != CE_None )
+				return false;
+			profile().read(size_t(W)*h);
+
+			for (int y = 0; y < h; y++)
+			{
+				const Word *r = row(sy+y);
+				unsigned char *dst = &strip[size_t(y)*W];
+				for (size_t i = 0; i < Words; i++)
+				{
+					Word m = r[i];
+					while (m)
+					{
+						dst[i*WordBits + __builtin_ctzll(m)] = val;
+						m &= m-1;
+					}
+				}
+			}
+
+			if( poBand->RasterIO( GF_Write, 0, y0+sy, W, h, &strip[0], W, h, GDT_Byte, 0, 0 ) != CE_None )
+				return false;
+			profile().written(size_t(W)*h);
+		}
+
+		return true;
+	}
+
+private:
+	int W, H;
+	size_t Words;
+	std::vector<Word> Bits;
+};
+
+#endif
@@ -0,0 +1,112 @@
+/* ========================================================================
+    File: @(#)gdal_iothread.h
+   ------------------------------------------------------------------------
+    background I/O thread for the gdal-tools
+    Copyright (C) 2014-2015 Christoph Hormann <chris_hormann@gmx.de>
+   ------------------------------------------------------------------------
+
+    This file is part of gdal-tools
+
+    gdal-tools is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gdal-tools is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gdal-tools.  If not, see <http://www.gnu.org/licenses/>.
+
+   ========================================================================
+ */
+
+#ifndef GDAL_IOTHREAD_H
+#define GDAL_IOTHREAD_H
+
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Thread running I/O jobs in the background so reading the next strip of
+// data (read-ahead) or writing the last one (write-behind) overlaps with
+// processing the current one.  The queue holds a single job: start() waits
+// for the previous job to finish first, so the buffer of a job is needed
+// until the next start() or wait() and two buffers used alternately are
+// sufficient.  A GDAL dataset must not be used by two threads at the same
+// time so the caller must not use the datasets of a pending job.
+class IOThread
+{
+public:
+	IOThread(): Busy(false), Failed(false), Quit(false), Thread([this]() { run(); })
+	{
+	}
+
+	~IOThread()
+	{
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			Done.wait(lock, [this]() { return !Busy; });
+			Quit = true;
+			Start.notify_one();
+		}
+		Thread.join();
+	}
+
+	// Start a job returning false on failure after the previous one has
+	// finished.  Returns false without starting it if a job failed before.
+	bool start(std::function<bool()> job)
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		Done.wait(lock, [this]() { return !Busy; });
+		if (Failed)
+			return false;
+		Job = job;
+		Busy = true;
+		Start.notify_one();
+		return true;
+	}
+
+	// wait for the pending job, returns false if any job failed
+	bool wait()
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		Done.wait(lock, [this]() { return !Busy; });
+		return !Failed;
+	}
+
+private:
+	std::mutex Mutex;
+	std::condition_variable Start;
+	std::condition_variable Done;
+	std::function<bool()> Job;
+	bool Busy;
+	bool Failed;
+	bool Quit;
+	std::thread Thread;
+
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(Mutex);
+		while (true)
+		{
+			Start.wait(lock, [this]() { return Busy || Quit; });
+			if (!Busy)
+				return;
+
+			lock.unlock();
+			bool ok = Job();
+			lock.lock();
+
+			Failed = Failed || !ok;
+			Job = nullptr;
+			Busy = false;
+			Done.notify_all();
+		}
+	}
+};
+
+#endif
@@ -25,13 +25,24 @@
 
       0.1: initial public version, September 2014
       0.1.1: bugfix, June 2015
+      0.2: optional interpolated scale factor grid, October 2026
+      0.3: tiled processing for large images, October 2026
+      0.4: distance transform limited to the buffer radius, October 2026
+      0.5: bit packed mask, October 2026
+      0.6: shared scale factor library, October 2026
+      0.7: analytic scale factors for common projections, October 2026
+      0.8: optional output to a new file written in the background, October 2026
+      0.9: data read ahead in the background, October 2026
+      0.10: per phase profile (GDAL_TOOLS_PROFILE), October 2026
 
    ========================================================================
  */
 
-const char PROGRAM_TITLE[] = "gdal_maskbuffer 0.1.1";
+const char PROGRAM_TITLE[] = "gdal_maskbuffer 0.10";
 
 #include <cstdlib>
+#include <cstring>
+#include <vector>
 #include <fstream>
 #include <iostream>
 #include <algorithm>
@@ -42,6 +53,13 @@ const char PROGRAM_TITLE[] = "gdal_maskbuffer 0.1.1";
 #include <projects.h>
 #include <proj_api.h>
 
+#include "gdal_scalefactors.h"
+#include "gdal_bitmask.h"
+#include "gdal_maskdistance.h"
+#include "gdal_iothread.h"
+#include "gdal_profile.h"
+#include "gdal_output.h"
+
 #define cimg_use_tiff 1
 #define cimg_use_png 1
 #define cimg_display 0
@@ -50,6 +68,290 @@ const char PROGRAM_TITLE[] = "gdal_maskbuffer 0.1.1";
 
 using namespace cimg_library;
 
+// statistics of the buffering
+struct BufferStats
+{
+	double min_scale;
+	double max_scale;
+	ScaleFactorErrors errors;
+	size_t cntmod;
+	size_t cnthalo;
+};
+
+// scale factors of single pixels of a region [x0,x0+w) x [y0,y1), taken from
+// strips of the grid where factors are interpolated or evaluated per row,
+// otherwise evaluated individually so pixels far from the mask edges do not
+// need any projection calls.
+class PixelFactors
+{
+public:
+	PixelFactors(ScaleFactorGrid &grid, int x0, int w, int y0, int y1):
+		Grid(grid), X0(x0), W(w), Y0(y0), Y1(y1), StripY(-1)
+	{
+	}
+
+	ScaleFactors get(int px, int py)
+	{
+		if (!Grid.interpolating())
+			return Grid.pixel(px, py);
+
+		int sy = Y0 + ScaleFactorGrid::BlockSize*((py-Y0)/ScaleFactorGrid::BlockSize);
+		if (sy != StripY)
+		{
+			Grid.fill(X0, sy, W, std::min<int>(ScaleFactorGrid::BlockSize, Y1-sy), Strip);
+			StripY = sy;
+		}
+		return Strip[size_t(py-sy)*W + (px-X0)];
+	}
+
+	const ScaleFactorGrid &grid() const { return Grid; }
+
+private:
+	ScaleFactorGrid &Grid;
+	int X0, W, Y0, Y1;
+	int StripY;
+	std::vector<ScaleFactors> Strip;
+};
+
+// buffer the pixels of row py within the distance limit, cand are the
+// candidate pixels from the distance transform with x relative to xoff,
+// set(px) is called for every pixel to be changed.
+template <class Set>
+static void buffer_row(Set set, int py, int xoff, const std::vector<DistancePixel> &cand,
+                       PixelFactors &facs, float radius, double pixel_size, int cap, BufferStats &stats)
+{
+	for (size_t i = 0; i < cand.size(); i++)
+	{
+		int px = xoff + cand[i].x;
+		const ScaleFactors f = facs.get(px, py);
+
+		if (f.ok)
+		{
+			double scale = std::max(f.h,f.k);
+			double r = scale*std::abs(radius)/pixel_size;
+
+			if (r >= cap)
+				stats.cnthalo++;
+
+			if (float(std::sqrt(double(cand[i].d2))) < r)
+			{
+				stats.cntmod++;
+				set(px);
+			}
+
+			stats.min_scale = std::min(stats.min_scale, scale);
+			stats.max_scale = std::max(stats.max_scale, scale);
+		}
+		else
+			stats.errors.report(facs.grid(), px, py);
+	}
+}
+
+// maximum of max(h,k) of all pixels, evaluated in tiles of tile_size x
+// BlockSize pixels aligned like in buffering so the factors are the same
+static double max_scale_all(ScaleFactorGrid &grid, int nXSize, int nYSize, int tile_size)
+{
+	double scale = 0.0;
+	std::vector<ScaleFactors> facs;
+
+	for (int y0 = 0; y0 < nYSize; y0 += ScaleFactorGrid::BlockSize)
+		for (int x0 = 0; x0 < nXSize; x0 += tile_size)
+		{
+			int tw = std::min(tile_size, nXSize-x0);
+			int th = std::min<int>(ScaleFactorGrid::BlockSize, nYSize-y0);
+			grid.fill(x0, y0, tw, th, facs);
+			for (size_t i = 0; i < facs.size(); i++)
+				if (facs[i].ok)
+					scale = std::max(scale, std::max(facs[i].h, facs[i].k));
+		}
+
+	return scale;
+}
+
+// Tiled buffering with memory use independent of the image size.  Tiles are
+// processed in rows, for every tile the distance field is generated for the
+// tile plus a halo of the maximum buffer radius in pixels.  Since the file may
+// be modified in place the original data of the rows needed as halo for the
+// next row of tiles is kept in a strip buffer.  While a row of tiles is
+// buffered the rows of the next one not in the strip yet are read into a
+// second buffer and with a new output file the previous one is written.
+static void buffer_tiled(GDALRasterBand *poBand, OutputDataset &output, int nXSize, int nYSize, ScaleFactorGrid &grid,
+                         float radius, double pixel_size, int tile_size, BufferStats &stats)
+{
+	const unsigned char val = BitMask::band_value(poBand, (radius > 0) ? 255 : 0);
+
+	std::fprintf(stderr,"  determining maximum scale...\n");
+	profile().phase("determining maximum scale");
+
+	double scale_max = grid.max_scale(nXSize, nYSize);
+
+	// the halo has to cover the buffer radius of every pixel, an estimate
+	// could truncate the buffer so the maximum is determined from all pixels
+	if (!grid.max_scale_exact())
+	{
+		std::fprintf(stderr,"    maximum scale %.4f is an estimate - evaluating all pixels...\n", scale_max);
+		scale_max = max_scale_all(grid, nXSize, nYSize, tile_size);
+	}
+
+	int halo = int(std::ceil(scale_max*std::abs(radius)/pixel_size)) + 1;
+
+	std::fprintf(stderr,"    maximum scale %.4f, halo %d pixels\n", scale_max, halo);
+
+	int strip_rows = tile_size + 2*halo;
+
+	std::fprintf(stderr,"  allocating strip buffers (%dx%d)...\n", nXSize, strip_rows);
+	profile().phase("allocating strip buffers");
+
+	CImg<unsigned char> strip = CImg<unsigned char>(nXSize,strip_rows,1,1);
+	CImg<unsigned char> ahead = CImg<unsigned char>(nXSize,std::min(nYSize, tile_size+halo),1,1);
+	CImg<unsigned char> outs[2];
+	outs[0] = CImg<unsigned char>(nXSize,tile_size,1,1);
+	if (!output.in_place())
+		outs[1] = CImg<unsigned char>(nXSize,tile_size,1,1);
+	std::vector<ScaleFactors> facs_tile;
+	std::vector<DistancePixel> cand;
+	GDALRasterBand *poOutBand = output.band(1);
+
+	// strip holds the original data of rows [strip_y1, strip_y2)
+	int strip_y1 = 0;
+	int strip_y2 = 0;
+
+	// rows [ry1,ry2) of the row of tiles at y0 not in the strip after the
+	// previous row of tiles
+	auto new_rows = [&](int y0, int &ry1, int &ry2)
+	{
+		ry1 = (y0 == 0) ? 0 : std::min(nYSize, y0+halo);
+		ry2 = std::min(nYSize, y0+tile_size+halo);
+	};
+
+	IOThread reader;
+	auto read = [&](int y0)
+	{
+		int ry1, ry2;
+		new_rows(y0, ry1, ry2);
+		unsigned char *pAhead = ahead.data();
+		if (ry2 > ry1)
+			reader.start([=]()
+			{
+				if (poBand->RasterIO( GF_Read, 0, ry1, nXSize, ry2-ry1, pAhead, nXSize, ry2-ry1, GDT_Byte, 0, 0 ) != CE_None)
+					return false;
+				profile().read(size_t(nXSize)*(ry2-ry1));
+				return true;
+			});
+	};
+
+	read(0);
+
+	std::fprintf(stderr,"  buffering in tiles of %dx%d pixels...\n", tile_size, tile_size);
+	profile().phase("buffering");
+
+	for (int y0 = 0; y0 < nYSize; y0 += tile_size)
+	{
+		int th = std::min(tile_size, nYSize-y0);
+		int y1 = std::max(0, y0-halo);
+		int y2 = std::min(nYSize, y0+th+halo);
+		CImg<unsigned char> &out = outs[output.in_place() ? 0 : (y0/tile_size) % 2];
+
+		// keep rows still needed, the rest has been read ahead
+		if (!reader.wait())
+		{
+			std::fprintf(stderr,"  reading data failed.\n\n");
+			std::exit(1);
+		}
+		if (strip_y2 > y1)
+		{
+			std::memmove(strip.data(), strip.data() + size_t(y1-strip_y1)*nXSize, size_t(strip_y2-y1)*nXSize);
+		}
+		int ry1, ry2;
+		new_rows(y0, ry1, ry2);
+		if (ry2 > ry1)
+			std::memcpy(strip.data() + size_t(ry1-y1)*nXSize, ahead.data(), size_t(ry2-ry1)*nXSize);
+		strip_y1 = y1;
+		strip_y2 = y2;
+
+		if (y0+tile_size < nYSize)
+			read(y0+tile_size);
+
+		std::memcpy(out.data(), strip.data() + size_t(y0-y1)*nXSize, size_t(th)*nXSize);
+
+		for (int x0 = 0; x0 < nXSize; x0 += tile_size)
+		{
+			int tw = std::min(tile_size, nXSize-x0);
+			int x1 = std::max(0, x0-halo);
+			int x2 = std::min(nXSize, x0+tw+halo);
+
+			if (halo < BoundedDistanceBase::Inf)
+			{
+				BoundedDistance<ByteMask> dist(ByteMask(strip.data() + x1, nXSize, val), x2-x1, y2-y1, halo);
+				PixelFactors facs(grid, x0, tw, y0, y0+th);
+
+				for (int py = y0; py < y0+th; py++)
+				{
+					unsigned char *row = out.data(0,py-y0);
+					dist.row(py-y1, x0-x1, x0+tw-x1, cand);
+					buffer_row([&](int px) { row[px] = val; }, py, x1, cand, facs, radius, pixel_size, halo, stats);
+				}
+				continue;
+			}
+
+			CImg<unsigned char> win = CImg<unsigned char>(x2-x1,y2-y1,1,1);
+			for (int py = y1; py < y2; py++)
+				std::memcpy(win.data(0, py-y1), strip.data() + size_t(py-y1)*nXSize + x1, x2-x1);
+
+			CImg<float> win_dist = win.get_distance(val);
+
+			grid.fill(x0, y0, tw, th, facs_tile);
+
+			for (int py = y0; py < y0+th; py++)
+			{
+				for (int px = x0; px < x0+tw; px++)
+				{
+					const ScaleFactors &f = facs_tile[size_t(py-y0)*tw + (px-x0)];
+
+					if (f.ok)
+					{
+						double scale = std::max(f.h,f.k);
+						double r = scale*std::abs(radius)/pixel_size;
+
+						if (r >= halo)
+							stats.cnthalo++;
+
+						if ((win_dist(px-x1,py-y1) < r) && (out(px,py-y0) != val))
+						{
+							stats.cntmod++;
+							out(px,py-y0) = val;
+						}
+
+						stats.min_scale = std::min(stats.min_scale, scale);
+						stats.max_scale = std::max(stats.max_scale, scale);
+					}
+					else
+						stats.errors.report(grid, px, py);
+				}
+			}
+		}
+
+		profile().pixels(size_t(nXSize)*th);
+
+		// in place the input must not be read while writing
+		if (output.in_place() && !reader.wait())
+		{
+			std::fprintf(stderr,"  reading data failed.\n\n");
+			std::exit(1);
+		}
+
+		unsigned char *pOut = out.data();
+		output.write([=]()
+		{
+			if (poOutBand->RasterIO( GF_Write, 0, y0, nXSize, th, pOut, nXSize, th, GDT_Byte, 0, 0 ) != CE_None)
+				return false;
+			profile().written(size_t(nXSize)*th);
+			return true;
+		});
+	}
+
+	output.flush();
+}
 
 int main(int argc,char **argv)
 {
@@ -60,27 +362,51 @@ int main(int argc,char **argv)
 	std::fprintf(stderr,"This is free software, and you are welcome to redistribute\n");
 	std::fprintf(stderr,"it under certain conditions; see COPYING for details.\n");
 
-	// two parameters: file name and buffer radius
+	profile().begin(PROGRAM_TITLE);
+
+	// two parameters: file name and buffer radius, options:
+	//   -t <tolerance>: interpolate scale factors with the given relative error
+	//   -T <size>: process in tiles of the given size
+	//   -o/-of/-co: output file, format and creation options
+
+	double tolerance = 0.0;
+	int tile_size = 0;
+	OutputDataset output;
+	std::vector<char *> args;
 
-	if (argc <= 2)
+	for (int i = 1; i < argc; i++)
 	{
-		std::fprintf(stderr,"  You need to supply an image file name and buffer radius\n\n");
+		if (output.option(argc, argv, i))
+			continue;
+		else if ((std::strcmp(argv[i], "-t") == 0) && (i+1 < argc))
+			tolerance = atof(argv[++i]);
+		else if ((std::strcmp(argv[i], "-T") == 0) && (i+1 < argc))
+		{
+			// tiles aligned to the scale factor grid blocks
+			tile_size = std::max(1, atoi(argv[++i]));
+			tile_size = ScaleFactorGrid::BlockSize*((tile_size+ScaleFactorGrid::BlockSize-1)/ScaleFactorGrid::BlockSize);
+		}
+		else
+			args.push_back(argv[i]);
+	}
+
+	if (args.size() < 2)
+	{
+		std::fprintf(stderr,"  You need to supply an image file name and buffer radius\n");
+		std::fprintf(stderr,"  options:\n");
+		std::fprintf(stderr,"    -t <tolerance>  interpolate scale factors with given maximum relative error\n");
+		std::fprintf(stderr,"    -T <size>       process in tiles of given size with limited memory use\n");
+		OutputDataset::usage();
+		std::fprintf(stderr,"\n");
 		std::exit(1);
 	}
 
-	char *fnm = argv[1];
-	float radius = atof(argv[2]);
+	char *fnm = args[0];
+	float radius = atof(args[1]);
 
 	GDALAllRegister();
 
-	GDALDataset  *poDataset;
-
-	poDataset = (GDALDataset *) GDALOpen( fnm, GA_Update );
-	if( poDataset == NULL )
-	{
-		std::fprintf(stderr,"  opening file %s failed.\n\n", fnm);
-		std::exit(1);
-	}
+	GDALDataset  *poDataset = output.open(fnm);
 
 	int nXSize = poDataset->GetRasterXSize();
 	int nYSize = poDataset->GetRasterYSize();
@@ -106,102 +432,145 @@ int main(int argc,char **argv)
 	char *str_proj4;
 	oSRS->exportToProj4(&str_proj4);
 
-	projPJ Proj = pj_init_plus(str_proj4);
-
-	if (!Proj)
-	{
-		std::fprintf(stderr,"  Initializing projection in Proj4 failed.\n\n");
-		std::exit(1);
-	}
-
 	std::fprintf(stderr,"  proj4: %s\n", str_proj4);
 
-	if (!Proj->inv)
-	{
-		std::fprintf(stderr,"  inverse not known for projection.\n\n");
+	ScaleFactorBackend *backend = create_backend(str_proj4);
+	if (!backend)
 		std::exit(1);
-	}
 
-	std::fprintf(stderr,"  allocating image (%dx%d)...\n", nXSize, nYSize);
+	double pixel_size = 0.5*(std::abs(adfGeoTransform[1])+std::abs(adfGeoTransform[5]));
 
-	CImg<unsigned char> img = CImg<unsigned char>(nXSize,nYSize,1,1);
-	CImg<float> img_dist;
+	ScaleFactorGrid grid(*backend, adfGeoTransform, tolerance);
+	if (grid.row_mode())
+		std::fprintf(stderr,"    separable projection - evaluating scale factors once per row\n");
 
-	std::fprintf(stderr,"  reading data...\n");
+	BufferStats stats;
+	stats.min_scale = 1.0e12;
+	stats.max_scale = -1.0e12;
+	stats.cntmod = 0;
+	stats.cnthalo = 0;
 
-	if( poBand->RasterIO( GF_Read, 0, 0, nXSize, nYSize, img.data(), nXSize, nYSize, GDT_Byte, 0, 0 ) != CE_None )
+	if (tile_size > 0)
 	{
-		std::fprintf(stderr,"  reading data failed.\n\n");
-		std::exit(1);
+		buffer_tiled(poBand, output, nXSize, nYSize, grid, radius, pixel_size, tile_size, stats);
 	}
+	else
+	{
+		std::fprintf(stderr,"  allocating image (%dx%d)...\n", nXSize, nYSize);
+		profile().phase("allocating image");
 
-	std::fprintf(stderr,"  generating distance field...\n");
+		// the mask with the pixels of value val set and the pixels to be changed
+		const unsigned char val = (radius > 0) ? 255 : 0;
+		BitMask img;
+		BitMask changed(nXSize, nYSize);
 
-	if (radius > 0)
-		img_dist = img.get_distance(255);
-	else
-		img_dist = img.get_distance(0);
+		std::fprintf(stderr,"  reading data...\n");
+		profile().phase("reading data");
 
-	std::fprintf(stderr,"  buffering...\n");
+		if (!img.read(poBand, nXSize, nYSize, val))
+		{
+			std::fprintf(stderr,"  reading data failed.\n\n");
+			std::exit(1);
+		}
 
-	double min_scale = 1.0e12;
-	double max_scale = -1.0e12;
-	size_t cnterr = 0;
-	size_t cntmod = 0;
+		std::fprintf(stderr,"  determining maximum scale...\n");
+		profile().phase("determining maximum scale");
 
-	double pixel_size = 0.5*(std::abs(adfGeoTransform[1])+std::abs(adfGeoTransform[5]));
+		double scale_max = grid.max_scale(nXSize, nYSize);
+		int cap = int(std::ceil(scale_max*std::abs(radius)/pixel_size)) + 1;
 
-	for (int py = 0; py < nYSize; py++)
-	{
-		for (int px = 0; px < nXSize; px++)
+		std::fprintf(stderr,"    maximum scale %.4f, buffer radius up to %d pixels\n", scale_max, cap);
+
+		// the distance field can only be limited if the maximum scale is
+		// known to bound the buffer radius of every pixel
+		if (!grid.max_scale_exact())
+			std::fprintf(stderr,"    maximum scale is an estimate - using unlimited distance field\n");
+
+		if ((cap < BoundedDistanceBase::Inf) && grid.max_scale_exact())
 		{
-			projUV dat_xy;
-			struct FACTORS facs;
+			std::fprintf(stderr,"  generating distance field...\n");
+			profile().phase("generating distance field");
 
-			dat_xy.u = adfGeoTransform[0] + adfGeoTransform[1] * (0.5+px) + adfGeoTransform[2] * (0.5+py);
-			dat_xy.v = adfGeoTransform[3] + adfGeoTransform[4] * (0.5+px) + adfGeoTransform[5] * (0.5+py);
+			BoundedDistance<BitMask::View> dist(img.view(), nXSize, nYSize, cap);
+			PixelFactors facs(grid, 0, nXSize, 0, nYSize);
+			std::vector<DistancePixel> cand;
 
-			projUV dat_ll = pj_inv(dat_xy, Proj);
+			std::fprintf(stderr,"  buffering...\n");
+			profile().phase("buffering");
 
-			int facs_bad = pj_factors(dat_ll, Proj, 0.0, &facs);
+			for (int py = 0; py < nYSize; py++)
+			{
+				dist.row(py, 0, nXSize, cand);
+				buffer_row([&](int px) { changed.set(px, py); }, py, 0, cand, facs, radius, pixel_size, cap, stats);
+			}
+		}
+		else
+		{
+			std::fprintf(stderr,"  generating distance field...\n");
+			profile().phase("generating distance field");
 
-			if (!facs_bad)
+			CImg<float> img_dist;
 			{
-				double scale = std::max(facs.h,facs.k);
-				if (img_dist(px,py) < scale*std::abs(radius)/pixel_size)
-				{
-					cntmod++;
-					if (radius > 0)
-						img(px,py) = 255;
-					else
-						img(px,py) = 0;
-				}
+				CImg<unsigned char> img_byte = CImg<unsigned char>(nXSize,nYSize,1,1);
+				for (int py = 0; py < nYSize; py++)
+					img.unpack_row(py, 0, nXSize, img_byte.data(0,py), 255, 0);
+				img_dist = img_byte.get_distance(255);
+			}
 
-				min_scale = std::min(min_scale, scale);
-				max_scale = std::max(max_scale, scale);
+			std::fprintf(stderr,"  buffering...\n");
+			profile().phase("buffering");
 
-				//std::fprintf(stderr,"    (%.2f/%.2f) -> (%.2f/%.2f), %.2f, %.2f\n", dat_xy.u, dat_xy.v, dat_ll.u, dat_ll.v, facs.h, facs.k);
+			std::vector<ScaleFactors> facs_strip;
 
-			}
-			else if (cnterr < 1000)
+			for (int py = 0; py < nYSize; py++)
 			{
-				std::fprintf(stderr,"    failure to get scaling factor for %.2f/%.2f\n", dat_xy.u, dat_xy.v);
-				cnterr++;
-				if (cnterr == 1000)
+				if (py % ScaleFactorGrid::BlockSize == 0)
+					grid.fill(0, py, nXSize, std::min<int>(ScaleFactorGrid::BlockSize, nYSize-py), facs_strip);
+
+				const ScaleFactors *facs_row = &facs_strip[size_t(py % ScaleFactorGrid::BlockSize)*nXSize];
+
+				for (int px = 0; px < nXSize; px++)
 				{
-					std::fprintf(stderr,"    more than 1000 errors - not showing further errors.\n");
+					const ScaleFactors &facs = facs_row[px];
+
+					if (facs.ok)
+					{
+						double scale = std::max(facs.h,facs.k);
+						if ((img_dist(px,py) < scale*std::abs(radius)/pixel_size) && !img.get(px,py))
+						{
+							stats.cntmod++;
+							changed.set(px,py);
+						}
+
+						stats.min_scale = std::min(stats.min_scale, scale);
+						stats.max_scale = std::max(stats.max_scale, scale);
+					}
+					else
+						stats.errors.report(grid, px, py);
 				}
 			}
 		}
-	}
 
-	std::fprintf(stderr,"    maximum scaling: %.4f, minimum scaling: %.4f\n", max_scale, min_scale);
-	std::fprintf(stderr,"    %ld pixels changed\n", cntmod);
-	std::fprintf(stderr,"  writing data...\n");
+		profile().pixels(size_t(nXSize)*nYSize);
 
-	if( poBand->RasterIO( GF_Write, 0, 0, nXSize, nYSize, img.data(), nXSize, nYSize, GDT_Byte, 0, 0 ) != CE_None )
-	{
-		std::fprintf(stderr,"  writing data failed.\n\n");
-		std::exit(1);
+		std::fprintf(stderr,"  writing data...\n");
+		profile().phase("writing data");
+
+		// unchanged pixels are copied from the input to a new output file
+		if (!changed.write_set(output.band(1), val, 0, poBand))
+		{
+			std::fprintf(stderr,"  writing data failed.\n\n");
+			std::exit(1);
+		}
 	}
+
+	output.close();
+
+	if ((tolerance > 0.0) || grid.row_mode())
+		std::fprintf(stderr,"    %ld scale factor evaluations for %ld pixels, maximum interpolation error: %.2g\n", grid.evaluations(), grid.pixels(), grid.max_error());
+	if (stats.max_scale >= stats.min_scale)
+		std::fprintf(stderr,"    maximum scaling: %.4f, minimum scaling: %.4f\n", stats.max_scale, stats.min_scale);
+	std::fprintf(stderr,"    %ld pixels changed\n", stats.cntmod);
+	if (stats.cnthalo > 0)
+		std::fprintf(stderr,"    warning: buffer radius exceeded the maximum estimate at %ld pixels\n", stats.cnthalo);
 }
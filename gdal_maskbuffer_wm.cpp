@@ -0,0 +1,321 @@
+/* ========================================================================
+    File: @(#)gdal_maskbuffer_wm.cpp
+   ------------------------------------------------------------------------
+    gdal_maskbuffer - buffers a raster mask in projected coordinates by
+                      a distance in real world units
+    web mercator version without proj4 dependecy
+    Copyright (C) 2015 Christoph Hormann <chris_hormann@gmx.de>
+   ------------------------------------------------------------------------
+
+    This file is part of gdal_maskbuffer_wm
+
+    gdal_maskbuffer_wm is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gdal_maskbuffer_wm is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gdal_maskbuffer_wm.  If not, see <http://www.gnu.org/licenses/>.
+
+    Version history:
+
+      0.1: initial version based on gdal_maskbuffer, tiled and multithreaded, October 2026
+      0.2: optional output to a new file written in the background, October 2026
+      0.3: data read ahead in the background, October 2026
+      0.4: per phase profile (GDAL_TOOLS_PROFILE), October 2026
+
+   ========================================================================
+ */
+
+const char PROGRAM_TITLE[] = "gdal_maskbuffer_wm 0.4";
+
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include <gdal_priv.h>
+
+#include "gdal_scalefactors.h"
+#include "gdal_bitmask.h"
+#include "gdal_maskdistance.h"
+#include "gdal_maskkernel.h"
+#include "gdal_iothread.h"
+#include "gdal_profile.h"
+#include "gdal_output.h"
+
+const double EarthRadius = 6378137.0;
+
+int main(int argc,char **argv)
+{
+	std::fprintf(stderr,"%s\n", PROGRAM_TITLE);
+	std::fprintf(stderr,"-------------------------------------------------------\n");
+	std::fprintf(stderr,"Copyright (C) 2015 Christoph Hormann\n");
+	std::fprintf(stderr,"This program comes with ABSOLUTELY NO WARRANTY;\n");
+	std::fprintf(stderr,"This is free software, and you are welcome to redistribute\n");
+	std::fprintf(stderr,"it under certain conditions; see COPYING for details.\n");
+
+	profile().begin(PROGRAM_TITLE);
+
+	// two parameters: file name and buffer radius, options:
+	//   -T <size>: tile size
+	//   -j <threads>: number of threads
+	//   -o/-of/-co: output file, format and creation options
+
+	int tile_size = 1024;
+	int nThreads = std::max(1u, std::thread::hardware_concurrency());
+	OutputDataset output;
+	std::vector<char *> args;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (output.option(argc, argv, i))
+			continue;
+		else if ((std::strcmp(argv[i], "-T") == 0) && (i+1 < argc))
+			tile_size = std::max(1, atoi(argv[++i]));
+		else if ((std::strcmp(argv[i], "-j") == 0) && (i+1 < argc))
+			nThreads = std::max(1, atoi(argv[++i]));
+		else
+			args.push_back(argv[i]);
+	}
+
+	// tiles of whole mask words so threads never write the same word
+	tile_size = BitMask::WordBits*((tile_size+BitMask::WordBits-1)/BitMask::WordBits);
+
+	if (args.size() < 2)
+	{
+		std::fprintf(stderr,"  You need to supply an image file name and buffer radius\n");
+		std::fprintf(stderr,"  options:\n");
+		std::fprintf(stderr,"    -T <size>       tile size (default: %d)\n", tile_size);
+		std::fprintf(stderr,"    -j <threads>    number of threads (default: %d)\n", nThreads);
+		OutputDataset::usage();
+		std::fprintf(stderr,"\n");
+		std::exit(1);
+	}
+
+	char *fnm = args[0];
+	float radius = atof(args[1]);
+
+	GDALAllRegister();
+
+	GDALDataset  *poDataset = output.open(fnm);
+
+	int nXSize = poDataset->GetRasterXSize();
+	int nYSize = poDataset->GetRasterYSize();
+
+	GDALRasterBand  *poBand = poDataset->GetRasterBand( 1 );
+
+	double adfGeoTransform[6];
+
+	if( poDataset->GetProjectionRef()  == NULL )
+	{
+		std::fprintf(stderr,"  Cannot process images without projection data\n\n");
+		std::exit(1);
+	}
+
+	if( poDataset->GetGeoTransform( adfGeoTransform ) != CE_None )
+	{
+		std::fprintf(stderr,"  error reading geotransform\n\n");
+		std::exit(1);
+	}
+
+	// the scale factors are the same along a row
+	WebMercatorBackend backend(EarthRadius);
+	ScaleFactorGrid grid(backend, adfGeoTransform, 0.0);
+	if (!grid.row_mode())
+	{
+		std::fprintf(stderr,"  Cannot process images with rotated geotransform\n\n");
+		std::exit(1);
+	}
+
+	double pixel_size = 0.5*(std::abs(adfGeoTransform[1])+std::abs(adfGeoTransform[5]));
+
+	// buffer radius in pixels for every row, the halo of a row of tiles is the
+	// largest radius of its rows so it is small near the equator
+	std::vector<double> row_scale(nYSize);
+	std::vector<ScaleFactors> facs;
+	for (int y0 = 0; y0 < nYSize; y0 += tile_size)
+	{
+		int th = std::min(tile_size, nYSize-y0);
+		grid.fill(0, y0, 1, th, facs);
+		for (int py = y0; py < y0+th; py++)
+			row_scale[py] = facs[py-y0].h;
+	}
+
+	int nTileRows = (nYSize+tile_size-1)/tile_size;
+	std::vector<int> halo(nTileRows);
+	std::vector<int> need_y1(nTileRows), need_y2(nTileRows);
+
+	for (int t = 0; t < nTileRows; t++)
+	{
+		int y0 = t*tile_size;
+		int th = std::min(tile_size, nYSize-y0);
+		double scale = *std::max_element(&row_scale[y0], &row_scale[y0]+th);
+		double h = std::ceil(scale*std::abs(radius)/pixel_size) + 1;
+		if (h >= BoundedDistanceBase::Inf)
+		{
+			std::fprintf(stderr,"  buffer radius of %.0f pixels too large.\n\n", h);
+			std::exit(1);
+		}
+		halo[t] = int(h);
+		need_y1[t] = std::max(0, y0-halo[t]);
+		need_y2[t] = std::min(nYSize, y0+th+halo[t]);
+	}
+
+	// Since the file may be modified in place the original data of the rows
+	// still needed by later rows of tiles is kept in a strip, rows are dropped
+	// once no later row of tiles needs them.  The rows [read_y1,read_y2) not
+	// in the strip yet are read ahead while the previous row of tiles is
+	// buffered.
+	std::vector<int> keep_y1(nTileRows);
+	std::vector<int> read_y1(nTileRows), read_y2(nTileRows);
+	int strip_rows = 0;
+	int ahead_rows = 0;
+	for (int t = nTileRows-1; t >= 0; t--)
+		keep_y1[t] = (t == nTileRows-1) ? need_y1[t] : std::min(need_y1[t], keep_y1[t+1]);
+	for (int t = 0, y2 = 0; t < nTileRows; t++)
+	{
+		read_y1[t] = std::max(keep_y1[t], y2);
+		y2 = std::max(y2, need_y2[t]);
+		read_y2[t] = y2;
+		strip_rows = std::max(strip_rows, y2-keep_y1[t]);
+		ahead_rows = std::max(ahead_rows, read_y2[t]-read_y1[t]);
+	}
+
+	std::fprintf(stderr,"  allocating strip buffer (%dx%d)...\n", nXSize, strip_rows);
+	profile().phase("allocating strip buffer");
+
+	// pixels changed in a row of tiles, with a new output file one row of
+	// tiles is written while the next one is buffered.  Unchanged pixels are
+	// copied from a separate handle of the input then.
+	BitMask strip(nXSize, strip_rows);
+	BitMask ahead(nXSize, ahead_rows);
+	BitMask changed_rows[2];
+	GDALRasterBand *poOutBand = output.band(1);
+	GDALRasterBand *poSrcBand = output.source_band(1);
+
+	int strip_y1 = 0;
+	int strip_y2 = 0;
+
+	IOThread reader;
+	auto read = [&](int t)
+	{
+		int ry1 = read_y1[t];
+		int ry2 = read_y2[t];
+		if (ry2 > ry1)
+			reader.start([&ahead, poBand, ry1, ry2, radius]()
+			{
+				return ahead.read_rows(poBand, ry1, ry2-ry1, 0, (radius > 0) ? 255 : 0);
+			});
+	};
+
+	read(0);
+
+	std::atomic<size_t> cntmod(0);
+
+	std::fprintf(stderr,"  buffering in tiles of %dx%d pixels using %d threads...\n", tile_size, tile_size, nThreads);
+	profile().phase("buffering");
+
+	for (int t = 0; t < nTileRows; t++)
+	{
+		int y0 = t*tile_size;
+		int th = std::min(tile_size, nYSize-y0);
+		int y1 = keep_y1[t];
+		int y2 = read_y2[t];
+
+		// keep rows still needed, the rest has been read ahead
+		if (!reader.wait())
+		{
+			std::fprintf(stderr,"  reading data failed.\n\n");
+			std::exit(1);
+		}
+		if (strip_y2 > y1)
+			strip.move_rows(y1-strip_y1, 0, strip_y2-y1);
+		strip.copy_rows(ahead, 0, read_y1[t]-y1, read_y2[t]-read_y1[t]);
+		strip_y1 = y1;
+		strip_y2 = y2;
+
+		if (t+1 < nTileRows)
+			read(t+1);
+
+		BitMask &changed = changed_rows[output.in_place() ? 0 : t % 2];
+		changed.resize(nXSize, th);
+
+		// distance limits of the rows, pixels closer than the radius are buffered
+		std::vector<unsigned int> limit(th);
+		std::vector<char> any(th);
+		for (int py = y0; py < y0+th; py++)
+			any[py-y0] = distance_limit(row_scale[py]*std::abs(radius)/pixel_size, limit[py-y0]);
+
+		int nTiles = (nXSize+tile_size-1)/tile_size;
+		int wy1 = need_y1[t];
+		int wy2 = need_y2[t];
+		std::atomic<int> next_tile(0);
+
+		std::vector<std::thread> threads;
+		for (int i = 0; i < std::min(nThreads, nTiles); i++)
+		{
+			threads.push_back(std::thread([&]()
+			{
+				std::vector<DistancePixel> cand;
+				size_t cnt = 0;
+
+				int c;
+				while ((c = next_tile++) < nTiles)
+				{
+					int x0 = c*tile_size;
+					int tw = std::min(tile_size, nXSize-x0);
+					int x1 = std::max(0, x0-halo[t]);
+					int x2 = std::min(nXSize, x0+tw+halo[t]);
+
+					BoundedDistance<BitMask::View> dist(strip.view(x1, wy1-strip_y1), x2-x1, wy2-wy1, halo[t]);
+
+					for (int py = y0; py < y0+th; py++)
+					{
+						if (!any[py-y0])
+							continue;
+						dist.row(py-wy1, x0-x1, x0+tw-x1, cand);
+						for (size_t k = 0; k < cand.size(); k++)
+							if (cand[k].d2 <= limit[py-y0])
+							{
+								changed.set(x1+cand[k].x, py-y0);
+								cnt++;
+							}
+					}
+				}
+
+				cntmod += cnt;
+			}));
+		}
+		for (size_t i = 0; i < threads.size(); i++)
+			threads[i].join();
+
+		profile().pixels(size_t(nXSize)*th);
+
+		// in place the input must not be read while writing
+		if (output.in_place() && !reader.wait())
+		{
+			std::fprintf(stderr,"  reading data failed.\n\n");
+			std::exit(1);
+		}
+
+		output.write([&changed, poOutBand, poSrcBand, radius, y0]()
+		{
+			return changed.write_set(poOutBand, (radius > 0) ? 255 : 0, y0, poSrcBand);
+		});
+	}
+
+	output.close();
+
+	std::fprintf(stderr,"    maximum scaling: %.4f, minimum scaling: %.4f\n",
+	             *std::max_element(row_scale.begin(), row_scale.end()), *std::min_element(row_scale.begin(), row_scale.end()));
+	std::fprintf(stderr,"    %ld pixels changed\n", size_t(cntmod));
+}
@@ -25,23 +25,51 @@
       0.1: initial public version, June 2015
       0.1.1: small change, August 2015
       0.2: fix scale factor compensation going the wrong way, October 2015
+      0.3: optional interpolated scale factor grid, October 2026
+      0.4: single distance field for both mask classes, October 2026
+      0.5: reusable reference mask index, October 2026
+      0.6: batch mode for several files and radii, October 2026
+      0.7: analysis of changed blocks only, October 2026
+      0.8: multithreaded analysis with stable area summation, October 2026
+      0.9: bit packed masks, October 2026
+      0.10: shared scale factor library, October 2026
+      0.11: analytic scale factors for common projections, October 2026
+      0.12: candidate files read in the background, October 2026
+      0.13: per phase profile (GDAL_TOOLS_PROFILE), October 2026
+      0.14: structured report with the differences per tile (-json, -csv), October 2026
+      0.15: difference hotspot raster (-hotspot), October 2026
+      0.16: configurable weights, distance histogram of the differences, October 2026
 
    ========================================================================
  */
 
-const char PROGRAM_TITLE[] = "gdal_maskcompare 0.2";
+const char PROGRAM_TITLE[] = "gdal_maskcompare 0.16";
 
 #include <cstdlib>
+#include <cstring>
+#include <vector>
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <thread>
+#include <atomic>
 
 #include <gdal_priv.h>
 #include <ogrsf_frmts.h>
+#include <ogr_spatialref.h>
 
 #include <projects.h>
 #include <proj_api.h>
 
+#include "gdal_scalefactors.h"
+#include "gdal_bitmask.h"
+#include "gdal_maskdistance.h"
+#include "gdal_iothread.h"
+#include "gdal_profile.h"
+#include "gdal_maskindex.h"
+#include "gdal_maskkernel.h"
+#include "gdal_maskreport.h"
+
 #define cimg_display 0
 
 #include "CImg.h"
@@ -49,233 +77,1069 @@ const char PROGRAM_TITLE[] = "gdal_maskcompare 0.2";
 using namespace cimg_library;
 
 
-int main(int argc,char **argv)
+
+// totals of radius r from the per row statistics of nr radii
+static CompareStats merge_rows(const std::vector<RowStats> &rows, int nr, int r)
 {
-	std::fprintf(stderr,"%s\n", PROGRAM_TITLE);
-	std::fprintf(stderr,"-------------------------------------------------------\n");
-	std::fprintf(stderr,"Copyright (C) 2015 Christoph Hormann\n");
-	std::fprintf(stderr,"This program comes with ABSOLUTELY NO WARRANTY;\n");
-	std::fprintf(stderr,"This is free software, and you are welcome to redistribute\n");
-	std::fprintf(stderr,"it under certain conditions; see COPYING for details.\n");
+	size_t n = rows.size()/nr;
+	std::vector<double> l(n), w(n), lx(n), wx(n);
 
-	// two parameters: file name and buffer radius
+	CompareStats cs;
+	std::memset(&cs, 0, sizeof(cs));
 
-	if (argc <= 3)
+	for (size_t py = 0; py < n; py++)
 	{
-		std::fprintf(stderr,"  You need to supply two image file name and a radius value\n\n");
-		std::exit(1);
+		const RowStats &rs = rows[py*nr+r];
+		cs.cnt_l += rs.cnt_l;
+		cs.cnt_w += rs.cnt_w;
+		cs.cnt_lx += rs.cnt_lx;
+		cs.cnt_wx += rs.cnt_wx;
+		l[py] = rs.area_l.sum;
+		w[py] = rs.area_w.sum;
+		lx[py] = rs.area_lx.sum;
+		wx[py] = rs.area_wx.sum;
 	}
 
-	char *fnm_ref = argv[1];
-	char *fnm = argv[2];
-	float radius = atof(argv[3]);
+	cs.area_l = tree_sum(&l[0], n);
+	cs.area_w = tree_sum(&w[0], n);
+	cs.area_lx = tree_sum(&lx[0], n);
+	cs.area_wx = tree_sum(&wx[0], n);
+	return cs;
+}
 
-	GDALAllRegister();
+static ScaleFactorErrors Errors;
 
-	GDALDataset *poDataset_ref;
-	GDALDataset *poDataset;
+// convert the scale factors of row py for the comparison and accumulate the
+// statistics independent of the candidate, returns the area of the row
+static double reference_row(ReferenceStats &rs, const ScaleFactorGrid &grid, const ScaleFactors *facs_row, CompareFactors *out, int py, int n, double pixel_size)
+{
+	KahanSum area = { 0.0, 0.0 };
 
-	poDataset_ref = (GDALDataset *) GDALOpen( fnm_ref, GA_ReadOnly );
-	if( poDataset_ref == NULL )
+	for (int px = 0; px < n; px++)
 	{
-		std::fprintf(stderr,"  opening file %s failed.\n\n", fnm_ref);
-		std::exit(1);
+		const ScaleFactors &facs = facs_row[px];
+
+		if (facs.ok)
+		{
+			out[px].scale = std::max(facs.h,facs.k);
+			out[px].ascale = facs.s*1000*1000; // in sqm/sqkm
+
+			rs.min_ascale = std::min(rs.min_ascale, facs.s);
+			rs.max_ascale = std::max(rs.max_ascale, facs.s);
+
+			rs.min_scale = std::min(rs.min_scale, out[px].scale);
+			rs.max_scale = std::max(rs.max_scale, out[px].scale);
+
+			area.add(pixel_size*pixel_size/out[px].ascale);
+		}
+		else
+		{
+			out[px].scale = 0.0;
+			out[px].ascale = 0.0;
+			Errors.report(grid, px, py);
+		}
 	}
 
-	poDataset = (GDALDataset *) GDALOpen( fnm, GA_ReadOnly );
-	if( poDataset == NULL )
+	return area.sum;
+}
+
+// count a difference pixel in the statistics of its class
+static inline void add_diff(RowStats &cs, bool in, bool normal, double area)
+{
+	if (in)
 	{
-		std::fprintf(stderr,"  opening file %s failed.\n\n", fnm);
-		std::exit(1);
+		if (normal)
+		{
+			cs.cnt_l++;
+			cs.area_l.add(area);
+		}
+		else
+		{
+			cs.cnt_lx++;
+			cs.area_lx.add(area);
+		}
+	}
+	else
+	{
+		if (normal)
+		{
+			cs.cnt_w++;
+			cs.area_w.add(area);
+		}
+		else
+		{
+			cs.cnt_wx++;
+			cs.area_wx.add(area);
+		}
+	}
+}
+
+// compare pixels [x1,x2) of a row of the candidate with the reference for
+// nr radii at once, only the bits set in the XOR of the mask words are
+// visited.  fstride is 0 if the factors are the same for the whole row,
+// dist2 starts at pixel x1 and is only used for radius > 0.  If tiles is
+// not NULL the differences are also counted there for the tile columns of
+// tile_size pixels (see TileStats::chunk()), if hist is not NULL their
+// distances are added to the histogram bins.  The factors are CompareFactors
+// or IndexFactors from an index.
+template <class Factors>
+static void compare_row(RowStats *cs, const float *radii, int nr, const BitMask::Word *ref, const BitMask::Word *cand,
+                        const unsigned int *dist2, const Factors *facs, int fstride, int x1, int x2, double pixel_size,
+                        RowStats *tiles = NULL, int tile_size = 0, DistanceHistogram::Bin *hist = NULL)
+{
+	for (int i = x1/BitMask::WordBits; i < (x2+BitMask::WordBits-1)/BitMask::WordBits; i++)
+	{
+		// new in mask or new out of mask pixels
+		BitMask::Word diff = (ref[i] ^ cand[i]) & BitMask::range(i, x1, x2);
+		while (diff)
+		{
+			int b = __builtin_ctzll(diff);
+			diff &= diff-1;
+
+			int px = i*BitMask::WordBits + b;
+			bool in = (cand[i] >> b) & 1;
+
+			const Factors &f = facs[px*fstride];
+			if (f.scale <= 0.0)
+				continue;
+
+			float d = dist2 ? float(std::sqrt(double(dist2[px-x1]))) : 0.0f;
+			double area = pixel_size*pixel_size/f.ascale;
+			RowStats *ts = tiles ? tiles + (px/tile_size)*nr : NULL;
+
+			if (hist && dist2)
+				DistanceHistogram::add(hist, std::sqrt(double(dist2[px-x1]))*pixel_size/f.scale, in, area);
+
+			for (int r = 0; r < nr; r++)
+			{
+				float dist = (radii[r] > 0) ? d : 0.0f;
+				bool normal = (dist < double(f.scale)*std::abs(radii[r])/pixel_size);
+
+				add_diff(cs[r], in, normal, area);
+				if (ts)
+					add_diff(ts[r], in, normal, area);
+			}
+		}
 	}
+}
 
-	int nXSize = poDataset_ref->GetRasterXSize();
-	int nYSize = poDataset_ref->GetRasterYSize();
+// reference data shared by all comparisons, memory mapped from an index
+struct ReferenceData
+{
+	int width;
+	int height;
+	bool row_mode;
+	const BitMask::Word *mask;
+	size_t words;
+	const unsigned int *dist2;
+	const IndexFactors *facs;
+};
 
-	if ((nXSize != poDataset->GetRasterXSize()) || (nYSize != poDataset->GetRasterYSize()))
+// compare a candidate with the reference using nThreads threads for chunks
+// of rows, cs receives the totals for the nr radii, tiles, if not NULL, the
+// differences per tile of tile_size pixels for every radius and hist, if
+// not NULL, the distance histogram
+static void compare_image(CompareStats *cs, CompareStats *tiles, int tile_size, HistogramStats *hist, const float *radii, int nr,
+                          const ReferenceData &ref, const BitMask &img, double pixel_size, int nThreads)
+{
+	std::vector<RowStats> rows(size_t(ref.height)*nr);
+	std::memset(&rows[0], 0, sizeof(RowStats)*rows.size());
+
+	TileStats *ts = tiles ? new TileStats(ref.width, ref.height, tile_size, ScaleFactorGrid::BlockSize, nr) : NULL;
+	DistanceHistogram *dh = hist ? new DistanceHistogram(ref.height, ScaleFactorGrid::BlockSize) : NULL;
+
+	std::atomic<int> next_chunk(0);
+	int nChunks = (ref.height+ScaleFactorGrid::BlockSize-1)/ScaleFactorGrid::BlockSize;
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < nThreads; i++)
 	{
-		std::fprintf(stderr,"  image files need to be same size.\n\n");
-		std::exit(1);
+		threads.push_back(std::thread([&]()
+		{
+			int c;
+			while ((c = next_chunk++) < nChunks)
+			{
+				int y1 = c*ScaleFactorGrid::BlockSize;
+				int y2 = std::min<int>(y1+ScaleFactorGrid::BlockSize, ref.height);
+				for (int py = y1; py < y2; py++)
+				{
+					size_t o = size_t(py)*ref.width;
+					compare_row(&rows[size_t(py)*nr], radii, nr, ref.mask+py*ref.words, img.row(py), ref.dist2 ? ref.dist2+o : NULL,
+					            ref.row_mode ? ref.facs+py : ref.facs+o, ref.row_mode ? 0 : 1, 0, ref.width, pixel_size,
+					            ts ? ts->chunk(py) : NULL, tile_size, dh ? dh->chunk(py) : NULL);
+				}
+			}
+		}));
 	}
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
 
-	GDALRasterBand  *poBand_ref = poDataset_ref->GetRasterBand( 1 );
-	GDALRasterBand  *poBand = poDataset->GetRasterBand( 1 );
+	for (int r = 0; r < nr; r++)
+		cs[r] = merge_rows(rows, nr, r);
 
-	double adfGeoTransform[6];
+	if (ts)
+	{
+		size_t nTiles = size_t(ts->cols())*ts->rows();
+		for (int r = 0; r < nr; r++)
+			ts->merge(r, tiles + r*nTiles);
+		delete ts;
+	}
 
-	if( poDataset_ref->GetProjectionRef()  == NULL )
+	if (dh)
 	{
-		std::fprintf(stderr,"  Cannot process image without projection data\n\n");
-		std::exit(1);
+		dh->merge(hist);
+		delete dh;
 	}
 
-	if( poDataset_ref->GetGeoTransform( adfGeoTransform ) != CE_None )
+	profile().pixels(size_t(ref.width)*ref.height);
+}
+
+// open a candidate file of the reference size, returns NULL on failure
+static GDALDataset *open_candidate(const char *fnm, int nXSize, int nYSize)
+{
+	GDALDataset *poDataset = (GDALDataset *) GDALOpen( fnm, GA_ReadOnly );
+	if( poDataset == NULL )
 	{
-		std::fprintf(stderr,"  error reading geotransform\n\n");
-		std::exit(1);
+		std::fprintf(stderr,"  opening file %s failed.\n", fnm);
+		return NULL;
 	}
 
-	OGRSpatialReference *oSRS = (OGRSpatialReference*)OSRNewSpatialReference(poDataset_ref->GetProjectionRef()); 
+	if ((nXSize != poDataset->GetRasterXSize()) || (nYSize != poDataset->GetRasterYSize()))
+	{
+		std::fprintf(stderr,"  image files need to be same size (%s).\n", fnm);
+		GDALClose(poDataset);
+		return NULL;
+	}
 
-	char *str_proj4;
-	oSRS->exportToProj4(&str_proj4);
+	return poDataset;
+}
+
+// read the first band of a candidate file, returns false on failure
+static bool read_candidate(const char *fnm, int nXSize, int nYSize, BitMask &img)
+{
+	GDALDataset *poDataset = open_candidate(fnm, nXSize, nYSize);
+	if (poDataset == NULL)
+		return false;
+
+	bool ok = img.read(poDataset->GetRasterBand( 1 ), nXSize, nYSize, 255);
+	if (!ok)
+		std::fprintf(stderr,"  reading data failed (%s).\n", fnm);
+
+	GDALClose(poDataset);
+	return ok;
+}
+
+static void print_result(const CompareStats &cs, const ReferenceStats &rs, const char *fnm, float radius, bool batch, const CompareWeights &weights)
+{
+	double area_weighted = weighted_area(cs, weights);
+
+	if (batch)
+		std::fprintf(stderr,"%s, radius %.2f:\n", fnm, radius);
+	std::fprintf(stderr,"new in mask: %ld normal pixel (%.2f sqkm)\n", cs.cnt_l, cs.area_l);
+	std::fprintf(stderr,"             %ld isolated pixel (%.2f sqkm)\n", cs.cnt_lx, cs.area_lx);
+	std::fprintf(stderr,"new out of mask: %ld normal pixel (%.2f sqkm)\n", cs.cnt_w, cs.area_w);
+	std::fprintf(stderr,"                 %ld isolated pixel (%.2f sqkm)\n", cs.cnt_wx, cs.area_wx);
+	std::fprintf(stderr,"difference rating: %.8f (%.2f sqkm)\n", area_weighted/rs.area_all, area_weighted);
+
+	// in batch mode radius and file name are appended to identify the line
+	if (batch)
+		std::fprintf(stdout,"short version: %ld:%.2f:%ld:%.2f:%ld:%.2f:%ld:%.2f:%.8f:%.2f:%g:%s\n", cs.cnt_l, cs.area_l, cs.cnt_lx, cs.area_lx, cs.cnt_w, cs.area_w, cs.cnt_wx, cs.area_wx, area_weighted/rs.area_all, area_weighted, radius, fnm);
+	else
+		std::fprintf(stdout,"short version: %ld:%.2f:%ld:%.2f:%ld:%.2f:%ld:%.2f:%.8f:%.2f\n", cs.cnt_l, cs.area_l, cs.cnt_lx, cs.area_lx, cs.cnt_w, cs.area_w, cs.cnt_wx, cs.area_wx, area_weighted/rs.area_all, area_weighted);
+}
 
-	projPJ Proj = pj_init_plus(str_proj4);
+// horizontal run of changed blocks with the squared distances of its pixels
+// to the nearest pixel of the other class in the reference mask
+struct ChangedRun
+{
+	int x0;
+	int y0;
+	int w;
+	int h;
+	std::vector<unsigned int> dist2;
+};
+
+// blocks of size bw x bh where reference and candidate differ, joined into
+// horizontal runs in row major order, returns the number of changed blocks
+static size_t changed_runs(const BitMask &ref, const BitMask &img, int nXSize, int nYSize, int bw, int bh, std::vector<ChangedRun> &runs)
+{
+	size_t cnt = 0;
 
-	if (!Proj)
+	for (int by = 0; by < nYSize; by += bh)
 	{
-		std::fprintf(stderr,"  Initializing projection in Proj4 failed.\n\n");
-		std::exit(1);
+		int h = std::min(bh, nYSize-by);
+		ChangedRun run;
+		run.w = 0;
+
+		for (int bx = 0; bx < nXSize; bx += bw)
+		{
+			int w = std::min(bw, nXSize-bx);
+			bool changed = false;
+			for (int py = by; (py < by+h) && !changed; py++)
+				changed = ref.differs(img, py, bx, bx+w);
+
+			if (changed)
+			{
+				cnt++;
+				if (run.w == 0)
+				{
+					run.x0 = bx;
+					run.y0 = by;
+					run.h = h;
+				}
+				run.w += w;
+			}
+			else if (run.w > 0)
+			{
+				runs.push_back(run);
+				run.w = 0;
+			}
+		}
+
+		if (run.w > 0)
+			runs.push_back(run);
 	}
 
-	double pixel_size = 0.5*(std::abs(adfGeoTransform[1])+std::abs(adfGeoTransform[5]));
+	return cnt;
+}
+
+// distances for the pixels of a changed run from a window around the run.
+// The halo of the window is larger than the largest threshold distance in
+// the run so any pixel closer than the threshold is inside the window and
+// the classification is the same as with a transform of the whole image.
+static void run_distance(ChangedRun &run, const BitMask &ref, int nXSize, int nYSize, ScaleFactorGrid &grid,
+                         float radius_max, double pixel_size, std::vector<ScaleFactors> &facs)
+{
+	// tile aligned to the scale factor grid blocks to get the same factors
+	// as the strips of the main loop
+	int ax0 = run.x0 - (run.x0 % ScaleFactorGrid::BlockSize);
+	int ay0 = run.y0 - (run.y0 % ScaleFactorGrid::BlockSize);
+	int ax1 = std::min<int>(nXSize, (run.x0+run.w+ScaleFactorGrid::BlockSize-1)/ScaleFactorGrid::BlockSize*ScaleFactorGrid::BlockSize);
+	int ay1 = std::min<int>(nYSize, (run.y0+run.h+ScaleFactorGrid::BlockSize-1)/ScaleFactorGrid::BlockSize*ScaleFactorGrid::BlockSize);
+	grid.fill(ax0, ay0, ax1-ax0, ay1-ay0, facs);
 
-	std::fprintf(stderr,"  proj4: %s\n", str_proj4);
-	std::fprintf(stderr,"  pixel size: %.2f m\n", pixel_size);
+	double scale = 0.0;
+	for (int py = run.y0; py < run.y0+run.h; py++)
+		for (int px = run.x0; px < run.x0+run.w; px++)
+		{
+			const ScaleFactors &f = facs[size_t(py-ay0)*(ax1-ax0) + (px-ax0)];
+			if (f.ok)
+				scale = std::max(scale, std::max(f.h, f.k));
+		}
+
+	int halo = int(std::ceil(scale*radius_max/pixel_size))+1;
+
+	int wx0 = std::max(0, run.x0-halo);
+	int wy0 = std::max(0, run.y0-halo);
+	int ww = std::min(nXSize, run.x0+run.w+halo) - wx0;
+	int wh = std::min(nYSize, run.y0+run.h+halo) - wy0;
+
+	std::vector<unsigned int> dist2;
+	opposite_distance(ref.view(wx0, wy0), ww, wh, dist2);
+
+	run.dist2.resize(size_t(run.w)*run.h);
+	for (int py = 0; py < run.h; py++)
+		std::memcpy(&run.dist2[size_t(py)*run.w], &dist2[size_t(run.y0-wy0+py)*ww + (run.x0-wx0)], sizeof(unsigned int)*run.w);
+}
+
+// per thread state of the reference pass, scale factor backends cannot be
+// shared between threads so every worker has its own
+struct CompareWorker
+{
+	ScaleFactorBackend *Backend;
+	ScaleFactorGrid *Grid;
+	std::vector<ScaleFactors> Facs;
+	std::vector<CompareFactors> Row;
+	ReferenceStats Stats;
+};
 
-	if (!Proj->inv)
+// reason why an index does not match the reference file, NULL if it does
+// or if the reference file does not exist so the index is used on its own
+static const char *index_mismatch(const MaskIndex &index, const char *fnm_ref)
+{
+	const MaskIndexHeader &hdr = index.header();
+
+	std::string path;
+	long long size, mtime;
+	if (!reference_file(fnm_ref, path, size, mtime))
+		return NULL;
+
+	if (path != index.reference())
+		return "was made from a different reference file";
+	if ((size != hdr.reference_size) || (mtime != hdr.reference_mtime))
+		return "is outdated";
+
+	GDALDataset *poDataset = (GDALDataset *) GDALOpen( fnm_ref, GA_ReadOnly );
+	if (poDataset == NULL)
+		return "does not match the reference file";
+
+	double adfGeoTransform[6];
+	bool match = (poDataset->GetRasterXSize() == hdr.width) && (poDataset->GetRasterYSize() == hdr.height) &&
+	             (poDataset->GetGeoTransform( adfGeoTransform ) == CE_None) &&
+	             std::equal(adfGeoTransform, adfGeoTransform+6, hdr.geotransform);
+	GDALClose(poDataset);
+
+	return match ? NULL : "does not match the reference file";
+}
+
+int main(int argc,char **argv)
+{
+	std::fprintf(stderr,"%s\n", PROGRAM_TITLE);
+	std::fprintf(stderr,"-------------------------------------------------------\n");
+	std::fprintf(stderr,"Copyright (C) 2015 Christoph Hormann\n");
+	std::fprintf(stderr,"This program comes with ABSOLUTELY NO WARRANTY;\n");
+	std::fprintf(stderr,"This is free software, and you are welcome to redistribute\n");
+	std::fprintf(stderr,"it under certain conditions; see COPYING for details.\n");
+
+	profile().begin(PROGRAM_TITLE);
+
+	// parameters: reference file name, one or more file names and radius, options:
+	//   -t <tolerance>: interpolate scale factors with the given relative error
+	//   -i <index>: use/create index file of the reference mask, with only
+	//               the reference file name given the index is just created
+	//   -r <radius>: radius, can be given several times, all parameters
+	//                after the reference file are then file names
+	//   -j <threads>: number of threads
+	//   -d: analyze only blocks that differ between the files
+	//   -w <l,lx,w,wx>: weights of the difference classes in the rating
+	//   -json/-csv/-hotspot/-T/-hist: structured report with the differences per tile
+
+	double tolerance = 0.0;
+	char *fnm_index = NULL;
+	bool block_diff = false;
+	CompareReport report;
+	CompareWeights weights;
+	int nThreads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<float> radii;
+	std::vector<char *> args;
+
+	for (int i = 1; i < argc; i++)
 	{
-		std::fprintf(stderr,"  inverse not known for projection.\n\n");
-		std::exit(1);
+		if (report.option(argc, argv, i))
+			continue;
+		else if ((std::strcmp(argv[i], "-t") == 0) && (i+1 < argc))
+			tolerance = atof(argv[++i]);
+		else if ((std::strcmp(argv[i], "-i") == 0) && (i+1 < argc))
+			fnm_index = argv[++i];
+		else if ((std::strcmp(argv[i], "-r") == 0) && (i+1 < argc))
+			radii.push_back(atof(argv[++i]));
+		else if ((std::strcmp(argv[i], "-j") == 0) && (i+1 < argc))
+			nThreads = std::max(1, atoi(argv[++i]));
+		else if ((std::strcmp(argv[i], "-w") == 0) && (i+1 < argc))
+		{
+			if (!weights.parse(argv[++i]))
+			{
+				std::fprintf(stderr,"  invalid weights %s, need l,lx,w,wx.\n\n", argv[i]);
+				std::exit(1);
+			}
+		}
+		else if (std::strcmp(argv[i], "-d") == 0)
+			block_diff = true;
+		else
+			args.push_back(argv[i]);
 	}
 
-	std::fprintf(stderr,"  allocating images (%dx%d)...\n", nXSize, nYSize);
+	if (radii.empty() && (args.size() >= 3))
+	{
+		radii.push_back(atof(args.back()));
+		args.pop_back();
+	}
 
-	CImg<unsigned char> img_ref = CImg<unsigned char>(nXSize,nYSize,1,1);
-	CImg<unsigned char> img = CImg<unsigned char>(nXSize,nYSize,1,1);
-	CImg<float> img_dist1;
-	CImg<float> img_dist2;
+	std::vector<char *> fnms;
+	if (args.size() > 1)
+		fnms.assign(args.begin()+1, args.end());
 
-	std::fprintf(stderr,"  reading data...\n");
+	bool index_only = fnm_index && (args.size() == 1) && radii.empty();
 
-	if( poBand_ref->RasterIO( GF_Read, 0, 0, nXSize, nYSize, img_ref.data(), nXSize, nYSize, GDT_Byte, 0, 0 ) != CE_None )
+	if (!index_only && (fnms.empty() || radii.empty()))
 	{
-		std::fprintf(stderr,"  reading reference data failed.\n\n");
+		std::fprintf(stderr,"  You need to supply a reference and one or more image file names and a radius value\n");
+		std::fprintf(stderr,"  options:\n");
+		std::fprintf(stderr,"    -t <tolerance>  interpolate scale factors with given maximum relative error\n");
+		std::fprintf(stderr,"    -i <index>      use index file of the reference mask, created if missing or outdated\n");
+		std::fprintf(stderr,"    -r <radius>     radius, can be given several times\n");
+		std::fprintf(stderr,"    -j <threads>    number of threads (default: %d)\n", nThreads);
+		std::fprintf(stderr,"    -w <l,lx,w,wx>  weights of the difference classes (default: 1,3,1,10)\n");
+		std::fprintf(stderr,"    -d              analyze only blocks that differ (single file without index)\n");
+		CompareReport::usage();
+		std::fprintf(stderr,"\n");
 		std::exit(1);
 	}
 
-	if( poBand->RasterIO( GF_Read, 0, 0, nXSize, nYSize, img.data(), nXSize, nYSize, GDT_Byte, 0, 0 ) != CE_None )
+	char *fnm_ref = args[0];
+	int nr = radii.size();
+	bool batch = (fnms.size() > 1) || (nr > 1);
+
+	// the histogram needs the distances for any radius
+	bool need_dist = report.histogram();
+	float radius_max = 0.0f;
+	for (int r = 0; r < nr; r++)
+		if (radii[r] > 0)
+		{
+			need_dist = true;
+			radius_max = std::max(radius_max, radii[r]);
+		}
+
+	GDALAllRegister();
+
+	MaskIndex index;
+	bool use_index = false;
+
+	struct stat st_index;
+	if (fnm_index && (stat(fnm_index, &st_index) == 0))
 	{
-		std::fprintf(stderr,"  reading data failed.\n\n");
-		std::exit(1);
+		const char *mismatch = NULL;
+		if (!index.map(fnm_index))
+			std::fprintf(stderr,"  index %s invalid - recreating.\n", fnm_index);
+		else if (index.header().tolerance != tolerance)
+		{
+			std::fprintf(stderr,"  index %s uses different tolerance - recreating.\n", fnm_index);
+			index.unmap();
+		}
+		else if ((mismatch = index_mismatch(index, fnm_ref)))
+		{
+			std::fprintf(stderr,"  index %s %s - recreating.\n", fnm_index, mismatch);
+			index.unmap();
+		}
+		else
+			use_index = true;
 	}
 
-	std::fprintf(stderr,"  generating distance fields...\n");
+	ReferenceStats rs;
+	rs.area_all = 0.0;
+	rs.min_scale = 1.0e12;
+	rs.max_scale = -1.0e12;
+	rs.min_ascale = 1.0e12;
+	rs.max_ascale = -1.0e12;
+	rs.cnterr = 0;
+
+	std::vector<CompareStats> results(fnms.size()*nr);
+	std::memset(&results[0], 0, sizeof(CompareStats)*results.size());
+
+	int nXSize, nYSize;
+	double pixel_size;
+	double adfGeoTransform[6];
+
+	// differences per tile of all files and radii and distance histograms
+	// of all files for the report
+	std::vector<CompareStats> tile_results;
+	std::vector<HistogramStats> hist_results;
+
+	// reference mask and distance field computed in memory
+	BitMask img_ref;
+	std::vector<unsigned int> ref_dist2;
 
-	if (radius > 0)
+	if (use_index)
 	{
-		img_dist1 = img_ref.get_distance(0);
-		img_dist2 = img_ref.get_distance(255);
+		const MaskIndexHeader &hdr = index.header();
+
+		nXSize = hdr.width;
+		nYSize = hdr.height;
+		pixel_size = hdr.pixel_size;
+		std::copy(hdr.geotransform, hdr.geotransform+6, adfGeoTransform);
+		rs = hdr.stats;
+
+		// the index only has the proj4 definition of the reference
+		char *wkt = NULL;
+		OGRSpatialReference oSRS;
+		if (report.enabled() && (oSRS.importFromProj4(index.proj4().c_str()) == OGRERR_NONE))
+			oSRS.exportToWkt(&wkt);
+		report.setup(PROGRAM_TITLE, fnm_ref, nXSize, nYSize, adfGeoTransform, wkt, ScaleFactorGrid::BlockSize);
+		CPLFree(wkt);
+
+		std::fprintf(stderr,"  using reference index %s\n", fnm_index);
+		std::fprintf(stderr,"  proj4: %s\n", index.proj4().c_str());
+		std::fprintf(stderr,"  pixel size: %.2f m\n", pixel_size);
+
+		if (index_only)
+			std::exit(0);
 	}
 	else
 	{
-		img_dist1 = img_ref.get_distance(255);
-		img_dist2 = img_ref.get_distance(0);
-	}
+		GDALDataset *poDataset_ref;
 
-	std::fprintf(stderr,"  analyzing...\n");
+		poDataset_ref = (GDALDataset *) GDALOpen( fnm_ref, GA_ReadOnly );
+		if( poDataset_ref == NULL )
+		{
+			std::fprintf(stderr,"  opening file %s failed.\n\n", fnm_ref);
+			std::exit(1);
+		}
 
-	size_t cnterr = 0;
-	size_t cnt_l = 0;
-	size_t cnt_w = 0;
-	size_t cnt_lx = 0;
-	size_t cnt_wx = 0;
-	double area_l = 0.0;
-	double area_w = 0.0;
-	double area_lx = 0.0;
-	double area_wx = 0.0;
-	double area_all = 0.0;
+		nXSize = poDataset_ref->GetRasterXSize();
+		nYSize = poDataset_ref->GetRasterYSize();
 
-	double min_scale = 1.0e12;
-	double max_scale = -1.0e12;
+		GDALRasterBand  *poBand_ref = poDataset_ref->GetRasterBand( 1 );
 
-	double min_ascale = 1.0e12;
-	double max_ascale = -1.0e12;
+		if( poDataset_ref->GetProjectionRef()  == NULL )
+		{
+			std::fprintf(stderr,"  Cannot process image without projection data\n\n");
+			std::exit(1);
+		}
 
-	for (int py = 0; py < nYSize; py++)
-	{
-		for (int px = 0; px < nXSize; px++)
+		if( poDataset_ref->GetGeoTransform( adfGeoTransform ) != CE_None )
 		{
-			projUV dat_xy;
-			struct FACTORS facs;
+			std::fprintf(stderr,"  error reading geotransform\n\n");
+			std::exit(1);
+		}
+
+		OGRSpatialReference *oSRS = (OGRSpatialReference*)OSRNewSpatialReference(poDataset_ref->GetProjectionRef()); 
+
+		char *str_proj4;
+		oSRS->exportToProj4(&str_proj4);
+
+		pixel_size = 0.5*(std::abs(adfGeoTransform[1])+std::abs(adfGeoTransform[5]));
+		report.setup(PROGRAM_TITLE, fnm_ref, nXSize, nYSize, adfGeoTransform, poDataset_ref->GetProjectionRef(), ScaleFactorGrid::BlockSize);
+
+		std::fprintf(stderr,"  proj4: %s\n", str_proj4);
+		std::fprintf(stderr,"  pixel size: %.2f m\n", pixel_size);
+
+		ScaleFactorBackend *backend = create_backend(str_proj4);
+		if (!backend)
+			std::exit(1);
+
+		// without index the files are compared while the scale factors are
+		// evaluated, a single file is read as a whole, several files in groups
+		// of rows with the factors so the factors are never kept for the whole
+		// image
+		bool single = !fnm_index && (fnms.size() == 1);
+		int nCands = fnm_index ? 0 : fnms.size();
+
+		if (block_diff && !single)
+		{
+			std::fprintf(stderr,"  block comparison only for a single file without index - ignored.\n");
+			block_diff = false;
+		}
+
+		if (block_diff && report.histogram())
+		{
+			std::fprintf(stderr,"  block comparison not possible with distance histogram - ignored.\n");
+			block_diff = false;
+		}
+
+		std::fprintf(stderr,"  allocating images (%dx%d)...\n", nXSize, nYSize);
+		profile().phase("allocating images");
+
+		BitMask img;
+
+		std::fprintf(stderr,"  reading data...\n");
+		profile().phase("reading data");
+
+		// a single candidate is read in the background while the reference is
+		// read and its distance field generated
+		IOThread reader;
+		if (single)
+			reader.start([&]() { return read_candidate(fnms[0], nXSize, nYSize, img); });
+
+		std::vector<GDALDataset *> cand_ds;
+		if (nCands > 1)
+			for (int f = 0; f < nCands; f++)
+			{
+				cand_ds.push_back(open_candidate(fnms[f], nXSize, nYSize));
+				if (cand_ds.back() == NULL)
+				{
+					std::fprintf(stderr,"\n");
+					std::exit(1);
+				}
+			}
+
+		if (!img_ref.read(poBand_ref, nXSize, nYSize, 255))
+		{
+			std::fprintf(stderr,"  reading reference data failed.\n\n");
+			std::exit(1);
+		}
+
+		std::vector<CompareWorker> workers(nThreads);
+		for (int i = 0; i < nThreads; i++)
+		{
+			workers[i].Backend = backend->clone();
+			workers[i].Grid = new ScaleFactorGrid(*workers[i].Backend, adfGeoTransform, tolerance);
+			workers[i].Row.resize(nXSize);
+			workers[i].Stats = rs;
+		}
+
+		bool row_mode = workers[0].Grid->row_mode();
+		if (row_mode)
+			std::fprintf(stderr,"    separable projection - evaluating scale factors once per row\n");
+
+		std::vector<ChangedRun> runs;
+
+		if (block_diff)
+		{
+			if (!reader.wait())
+			{
+				std::fprintf(stderr,"\n");
+				std::exit(1);
+			}
+
+			int nBlockXSize, nBlockYSize;
+			poBand_ref->GetBlockSize(&nBlockXSize, &nBlockYSize);
+
+			size_t nBlocks = size_t((nXSize+nBlockXSize-1)/nBlockXSize)*((nYSize+nBlockYSize-1)/nBlockYSize);
+			size_t nChanged = changed_runs(img_ref, img, nXSize, nYSize, nBlockXSize, nBlockYSize, runs);
+
+			std::fprintf(stderr,"  %ld of %ld blocks (%dx%d) differ\n", nChanged, nBlocks, nBlockXSize, nBlockYSize);
+
+			if (need_dist)
+			{
+				std::fprintf(stderr,"  generating distance fields of changed blocks...\n");
+				profile().phase("generating distance field");
+				for (size_t k = 0; k < runs.size(); k++)
+					run_distance(runs[k], img_ref, nXSize, nYSize, *workers[0].Grid, radius_max, pixel_size, workers[0].Facs);
+			}
+		}
+		else if (need_dist || fnm_index)
+		{
+			std::fprintf(stderr,"  generating distance field...\n");
+			profile().phase("generating distance field");
+
+			// squared distance to the nearest pixel of the other class in the
+			// reference mask, the index has it for any radius
+			opposite_distance(img_ref.view(), nXSize, nYSize, ref_dist2);
+		}
+
+		if (!reader.wait())
+		{
+			std::fprintf(stderr,"\n");
+			std::exit(1);
+		}
+
+		MaskIndexWriter writer;
+
+		if (fnm_index)
+		{
+			std::fprintf(stderr,"  writing reference index %s...\n", fnm_index);
+			profile().phase("writing reference index");
+
+			MaskIndexHeader hdr;
+			std::memset(&hdr, 0, sizeof(hdr));
+			hdr.width = nXSize;
+			hdr.height = nYSize;
+			hdr.row_mode = row_mode;
+			std::copy(adfGeoTransform, adfGeoTransform+6, hdr.geotransform);
+			hdr.tolerance = tolerance;
+			hdr.pixel_size = pixel_size;
+
+			// references not in the file system (like /vsicurl/) can not be
+			// identified, their index is used as long as it exists
+			std::string reference;
+			reference_file(fnm_ref, reference, hdr.reference_size, hdr.reference_mtime);
+
+			if (!writer.create(fnm_index, hdr, str_proj4, reference))
+			{
+				std::fprintf(stderr,"  creating index file %s failed.\n\n", fnm_index);
+				std::exit(1);
+			}
+		}
+		else if (single)
+		{
+			std::fprintf(stderr,"  analyzing using %d threads...\n", nThreads);
+			profile().phase("analyzing");
+		}
+		else
+		{
+			std::fprintf(stderr,"  analyzing %d files using %d threads...\n", nCands, nThreads);
+			profile().phase("analyzing");
+		}
 
-			dat_xy.u = adfGeoTransform[0] + adfGeoTransform[1] * (0.5+px) + adfGeoTransform[2] * (0.5+py);
-			dat_xy.v = adfGeoTransform[3] + adfGeoTransform[4] * (0.5+px) + adfGeoTransform[5] * (0.5+py);
+		// the rows are processed in groups of one chunk of rows per thread,
+		// the index factors of a group are written in order after each group
+		size_t nfacs = row_mode ? 1 : nXSize;
+		int nGroupRows = nThreads*ScaleFactorGrid::BlockSize;
 
-			projUV dat_ll = pj_inv(dat_xy, Proj);
+		std::vector<double> row_area(nYSize);
+		std::vector<IndexFactors> group_facs;
+		std::vector<std::vector<RowStats> > rows(nCands);
+		std::vector<TileStats *> tiles(nCands, (TileStats *)NULL);
+		std::vector<DistanceHistogram *> hist(nCands, (DistanceHistogram *)NULL);
 
-			int facs_bad = pj_factors(dat_ll, Proj, 0.0, &facs);
+		if (fnm_index)
+			group_facs.resize(std::min(nGroupRows, nYSize)*nfacs);
 
-			if (!facs_bad)
+		for (int f = 0; f < nCands; f++)
+		{
+			rows[f].resize(size_t(nYSize)*nr);
+			std::memset(&rows[f][0], 0, sizeof(RowStats)*rows[f].size());
+			if (report.enabled())
+				tiles[f] = new TileStats(nXSize, nYSize, report.tile_size(), ScaleFactorGrid::BlockSize, nr);
+			if (report.histogram())
+				hist[f] = new DistanceHistogram(nYSize, ScaleFactorGrid::BlockSize);
+		}
+
+		// rows of the candidates for the current and the next group, the
+		// next group is read while the current one is compared
+		std::vector<BitMask> cand_rows[2];
+		auto read_group = [&](int g0)
+		{
+			std::vector<BitMask> &cr = cand_rows[(g0/nGroupRows) % 2];
+			int h = std::min(nGroupRows, nYSize-g0);
+			return reader.start([&cr, g0, h, &cand_ds, &fnms]()
 			{
-				double scale = std::max(facs.h,facs.k);
-				double ascale = facs.s*1000*1000; // in sqm/sqkm
+				for (size_t f = 0; f < cand_ds.size(); f++)
+					if (!cr[f].read_rows(cand_ds[f]->GetRasterBand( 1 ), g0, h, 0, 255))
+					{
+						std::fprintf(stderr,"  reading data failed (%s).\n", fnms[f]);
+						return false;
+					}
+				return true;
+			});
+		};
 
-				min_ascale = std::min(min_ascale, facs.s);
-				max_ascale = std::max(max_ascale, facs.s);
+		if (nCands > 1)
+		{
+			for (int i = 0; i < 2; i++)
+				cand_rows[i].assign(nCands, BitMask(nXSize, std::min(nGroupRows, nYSize)));
+			read_group(0);
+		}
+
+		for (int g0 = 0; g0 < nYSize; g0 += nGroupRows)
+		{
+			int g1 = std::min(g0+nGroupRows, nYSize);
+			const std::vector<BitMask> &group = cand_rows[(g0/nGroupRows) % 2];
 
-				min_scale = std::min(min_scale, scale);
-				max_scale = std::max(max_scale, scale);
+			if (nCands > 1)
+			{
+				if (!reader.wait())
+				{
+					std::fprintf(stderr,"\n");
+					std::exit(1);
+				}
+				if (g1 < nYSize)
+					read_group(g1);
+			}
 
-				area_all += pixel_size*pixel_size/ascale;
+			std::atomic<int> next_chunk(0);
+			int nChunks = (g1-g0+ScaleFactorGrid::BlockSize-1)/ScaleFactorGrid::BlockSize;
 
-				if (img(px,py) == 255)
+			std::vector<std::thread> threads;
+			for (int i = 0; i < nThreads; i++)
+			{
+				threads.push_back(std::thread([&, i]()
 				{
-					// new in mask pixel
-					if (img_ref(px,py) == 0)
+					CompareWorker &w = workers[i];
+					int c;
+					while ((c = next_chunk++) < nChunks)
 					{
-						if (img_dist2(px,py) < scale*std::abs(radius)/pixel_size)
-						{
-							cnt_l++;
-							area_l += pixel_size*pixel_size/ascale;
-						}
-						else
+						int y1 = g0 + c*ScaleFactorGrid::BlockSize;
+						int y2 = std::min<int>(y1+ScaleFactorGrid::BlockSize, g1);
+						w.Grid->fill(0, y1, nXSize, y2-y1, w.Facs);
+
+						for (int py = y1; py < y2; py++)
 						{
-							cnt_lx++;
-							area_lx += pixel_size*pixel_size/ascale;
+							row_area[py] = reference_row(w.Stats, *w.Grid, &w.Facs[size_t(py-y1)*nXSize], &w.Row[0], py, nXSize, pixel_size);
+
+							if (fnm_index)
+								std::transform(w.Row.begin(), w.Row.begin()+nfacs, group_facs.begin()+size_t(py-g0)*nfacs, index_factors);
+							else if (block_diff)
+							{
+								// only the changed runs intersecting this row
+								size_t k = std::lower_bound(runs.begin(), runs.end(), py, [](const ChangedRun &run, int y) { return run.y0+run.h <= y; }) - runs.begin();
+								for (; (k < runs.size()) && (runs[k].y0 <= py); k++)
+								{
+									const ChangedRun &run = runs[k];
+									compare_row(&rows[0][size_t(py)*nr], &radii[0], nr, img_ref.row(py), img.row(py), need_dist ? &run.dist2[size_t(py-run.y0)*run.w] : NULL,
+									            &w.Row[0], 1, run.x0, run.x0+run.w, pixel_size, tiles[0] ? tiles[0]->chunk(py) : NULL, report.tile_size());
+								}
+							}
+							else
+							{
+								size_t o = size_t(py)*nXSize;
+								for (int f = 0; f < nCands; f++)
+									compare_row(&rows[f][size_t(py)*nr], &radii[0], nr, img_ref.row(py), single ? img.row(py) : group[f].row(py-g0),
+									            need_dist ? &ref_dist2[o] : NULL, &w.Row[0], 1, 0, nXSize, pixel_size,
+									            tiles[f] ? tiles[f]->chunk(py) : NULL, report.tile_size(), hist[f] ? hist[f]->chunk(py) : NULL);
+							}
 						}
 					}
+				}));
+			}
+			for (size_t i = 0; i < threads.size(); i++)
+				threads[i].join();
+
+			if (fnm_index && !writer.write(&group_facs[0], sizeof(IndexFactors)*(g1-g0)*nfacs))
+			{
+				std::fprintf(stderr,"  writing index file %s failed.\n\n", fnm_index);
+				std::exit(1);
+			}
+		}
+
+		size_t evaluations = 0;
+		size_t pixels = 0;
+		double max_error = 0.0;
+
+		for (int i = 0; i < nThreads; i++)
+		{
+			rs.min_scale = std::min(rs.min_scale, workers[i].Stats.min_scale);
+			rs.max_scale = std::max(rs.max_scale, workers[i].Stats.max_scale);
+			rs.min_ascale = std::min(rs.min_ascale, workers[i].Stats.min_ascale);
+			rs.max_ascale = std::max(rs.max_ascale, workers[i].Stats.max_ascale);
+			evaluations += workers[i].Grid->evaluations();
+			pixels += workers[i].Grid->pixels();
+			max_error = std::max(max_error, workers[i].Grid->max_error());
+
+			delete workers[i].Grid;
+			delete workers[i].Backend;
+		}
+		rs.area_all = tree_sum(&row_area[0], nYSize);
+		rs.cnterr = Errors.count();
+
+		if ((tolerance > 0.0) || row_mode)
+			std::fprintf(stderr,"    %ld scale factor evaluations for %ld pixels, maximum interpolation error: %.2g\n", evaluations, pixels, max_error);
+
+		for (size_t f = 0; f < cand_ds.size(); f++)
+			GDALClose(cand_ds[f]);
+
+		for (int f = 0; f < nCands; f++)
+		{
+			for (int r = 0; r < nr; r++)
+				results[size_t(f)*nr+r] = merge_rows(rows[f], nr, r);
+			profile().pixels(size_t(nXSize)*nYSize);
+
+			if (tiles[f])
+			{
+				tile_results.resize(size_t(nCands)*nr*report.tiles());
+				for (int r = 0; r < nr; r++)
+					tiles[f]->merge(r, &tile_results[(size_t(f)*nr+r)*report.tiles()]);
+				delete tiles[f];
+			}
+
+			if (hist[f])
+			{
+				hist_results.resize(size_t(nCands)*DistanceHistogram::Bins);
+				hist[f]->merge(&hist_results[size_t(f)*DistanceHistogram::Bins]);
+				delete hist[f];
+			}
+		}
+
+		if (fnm_index)
+		{
+			if (!writer.write_padded(&ref_dist2[0], sizeof(unsigned int)*ref_dist2.size()) ||
+			    !writer.write(img_ref.row(0), img_ref.bytes()) ||
+			    !writer.finish(rs))
+			{
+				std::fprintf(stderr,"  writing index file %s failed.\n\n", fnm_index);
+				std::exit(1);
+			}
+
+			if (index_only)
+				std::exit(0);
+
+			if (!index.map(fnm_index))
+			{
+				std::fprintf(stderr,"  reading index file %s failed.\n\n", fnm_index);
+				std::exit(1);
+			}
+			use_index = true;
+		}
+
+		delete backend;
+		GDALClose(poDataset_ref);
+	}
+
+	if (use_index)
+	{
+		ReferenceData ref;
+		ref.width = nXSize;
+		ref.height = nYSize;
+		ref.row_mode = index.header().row_mode;
+		ref.mask = index.mask(0);
+		ref.words = index.mask_words();
+		ref.dist2 = index.dist2(0);
+		ref.facs = index.factors(0);
+
+		// the files are read and compared in a single scan each, with at
+		// least as many files as threads several files in parallel,
+		// otherwise one after the other with the rows in parallel
+		int nFiles = fnms.size();
+
+		std::fprintf(stderr,"  analyzing %d file(s) using %d threads...\n", nFiles, nThreads);
+		profile().phase("analyzing");
+
+		size_t nTiles = report.tiles();
+		if (report.enabled())
+			tile_results.resize(nFiles*nr*nTiles);
+		if (report.histogram())
+			hist_results.resize(nFiles*DistanceHistogram::Bins);
+		auto file_tiles = [&](int f) { return report.enabled() ? &tile_results[size_t(f)*nr*nTiles] : NULL; };
+		auto file_hist = [&](int f) { return report.histogram() ? &hist_results[size_t(f)*DistanceHistogram::Bins] : NULL; };
+
+		if (nFiles < nThreads)
+		{
+			// the next file is read while one is compared
+			BitMask imgs[2];
+			IOThread reader;
+			auto read = [&](int f)
+			{
+				reader.start([&, f]() { return read_candidate(fnms[f], nXSize, nYSize, imgs[f % 2]); });
+			};
+
+			read(0);
+			for (int f = 0; f < nFiles; f++)
+			{
+				if (!reader.wait())
+				{
+					std::fprintf(stderr,"\n");
+					std::exit(1);
 				}
-				else
+				if (f+1 < nFiles)
+					read(f+1);
+				compare_image(&results[size_t(f)*nr], file_tiles(f), report.tile_size(), file_hist(f), &radii[0], nr, ref, imgs[f % 2], pixel_size, nThreads);
+			}
+		}
+		else
+		{
+			std::atomic<int> next_file(0);
+			std::atomic<bool> failed(false);
+
+			std::vector<std::thread> threads;
+			for (int i = 0; i < nThreads; i++)
+			{
+				threads.push_back(std::thread([&]()
 				{
-					// new out of mask pixel
-					if (img_ref(px,py) == 255)
+					BitMask img;
+					int f;
+					while ((f = next_file++) < nFiles)
 					{
-						if (img_dist1(px,py) < scale*std::abs(radius)/pixel_size)
+						if (!read_candidate(fnms[f], nXSize, nYSize, img))
 						{
-							cnt_w++;
-							area_w += pixel_size*pixel_size/ascale;
-						}
-						else
-						{
-							cnt_wx++;
-							area_wx += pixel_size*pixel_size/ascale;
+							failed = true;
+							break;
 						}
+						compare_image(&results[size_t(f)*nr], file_tiles(f), report.tile_size(), file_hist(f), &radii[0], nr, ref, img, pixel_size, 1);
 					}
-				}
+				}));
 			}
-			else if (cnterr < 1000)
+			for (size_t i = 0; i < threads.size(); i++)
+				threads[i].join();
+
+			if (failed)
 			{
-				std::fprintf(stderr,"    failure to get scaling factor for %.2f/%.2f\n", dat_xy.u, dat_xy.v);
-				cnterr++;
-				if (cnterr == 1000)
-				{
-					std::fprintf(stderr,"    more than 1000 errors - not showing further errors.\n");
-				}
+				std::fprintf(stderr,"\n");
+				std::exit(1);
 			}
 		}
 	}
 
-	double area_weighted = area_l+area_w+3.0*area_lx+10.0*area_wx;
+	std::fprintf(stderr,"maximum area scaling: %.4f, minimum: %.4f\n", rs.max_ascale, rs.min_ascale);
+	std::fprintf(stderr,"maximum scaling: %.4f, minimum scaling: %.4f\n", rs.max_scale, rs.min_scale);
 
-	std::fprintf(stderr,"maximum area scaling: %.4f, minimum: %.4f\n", max_ascale, min_ascale);
-	std::fprintf(stderr,"maximum scaling: %.4f, minimum scaling: %.4f\n", max_scale, min_scale);
+	for (size_t f = 0; f < fnms.size(); f++)
+		for (int r = 0; r < nr; r++)
+			print_result(results[f*nr+r], rs, fnms[f], radii[r], batch, weights);
 
-	std::fprintf(stderr,"new in mask: %ld normal pixel (%.2f sqkm)\n", cnt_l, area_l);
-	std::fprintf(stderr,"             %ld isolated pixel (%.2f sqkm)\n", cnt_lx, area_lx);
-	std::fprintf(stderr,"new out of mask: %ld normal pixel (%.2f sqkm)\n", cnt_w, area_w);
-	std::fprintf(stderr,"                 %ld isolated pixel (%.2f sqkm)\n", cnt_wx, area_wx);
-	std::fprintf(stderr,"difference rating: %.8f (%.2f sqkm)\n", area_weighted/area_all, area_weighted);
-	std::fprintf(stdout,"short version: %ld:%.2f:%ld:%.2f:%ld:%.2f:%ld:%.2f:%.8f:%.2f\n", cnt_l, area_l, cnt_lx, area_lx, cnt_w, area_w, cnt_wx, area_wx, area_weighted/area_all, area_weighted);
+	if (report.enabled() || report.histogram())
+	{
+		report.set_area(rs.area_all);
+		report.set_weights(weights);
+		for (size_t f = 0; f < fnms.size(); f++)
+		{
+			if (report.enabled())
+				for (int r = 0; r < nr; r++)
+					report.add(fnms[f], radii[r], results[f*nr+r], &tile_results[(f*nr+r)*report.tiles()]);
+			if (report.histogram())
+				report.add_histogram(fnms[f], &hist_results[f*DistanceHistogram::Bins]);
+		}
+		if (!report.write())
+			std::exit(1);
+	}
 
 }
@@ -25,16 +25,30 @@
 
       0.1: initial version based on gdal_maskcompare, October 2015
       0.2: fix scale factor compensation going the wrong way, October 2015
+      0.3: single distance field for both mask classes, October 2026
+      0.4: vectorized classification kernel, October 2026
+      0.5: multithreaded analysis with stable area summation, October 2026
+      0.6: bit packed masks, October 2026
+      0.7: shared scale factor library, October 2026
+      0.8: candidate read in the background, October 2026
+      0.9: per phase profile (GDAL_TOOLS_PROFILE), October 2026
+      0.10: structured report with the differences per tile (-json, -csv), October 2026
+      0.11: difference hotspot raster (-hotspot), October 2026
+      0.12: several radii in one scan, configurable weights, distance histogram, October 2026
 
    ========================================================================
  */
 
-const char PROGRAM_TITLE[] = "gdal_maskcompare_wm 0.2";
+const char PROGRAM_TITLE[] = "gdal_maskcompare_wm 0.12";
 
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <vector>
+#include <thread>
+#include <atomic>
 
 #include <gdal_priv.h>
 #include <ogrsf_frmts.h>
@@ -43,6 +57,14 @@ const char PROGRAM_TITLE[] = "gdal_maskcompare_wm 0.2";
 
 #include "CImg.h"
 
+#include "gdal_scalefactors.h"
+#include "gdal_bitmask.h"
+#include "gdal_maskdistance.h"
+#include "gdal_maskkernel.h"
+#include "gdal_iothread.h"
+#include "gdal_profile.h"
+#include "gdal_maskreport.h"
+
 using namespace cimg_library;
 
 const double EarthRadius = 6378137.0;
@@ -56,17 +78,71 @@ int main(int argc,char **argv)
 	std::fprintf(stderr,"This is free software, and you are welcome to redistribute\n");
 	std::fprintf(stderr,"it under certain conditions; see COPYING for details.\n");
 
-	// two parameters: file name and buffer radius
+	profile().begin(PROGRAM_TITLE);
+
+	// three parameters: reference file name, file name and radius, options:
+	//   -c: check the vectorized classification against the scalar version
+	//   -j <threads>: number of threads
+	//   -r <radius>: radius, can be given several times, the radius
+	//                parameter is then omitted
+	//   -w <l,lx,w,wx>: weights of the difference classes in the rating
+	//   -json/-csv/-hotspot/-T/-hist: structured report with the differences per tile
+
+	bool check = false;
+	CompareReport report;
+	CompareWeights weights;
+	int nThreads = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<float> radii;
+	std::vector<char *> args;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (report.option(argc, argv, i))
+			continue;
+		else if (std::strcmp(argv[i], "-c") == 0)
+			check = true;
+		else if ((std::strcmp(argv[i], "-j") == 0) && (i+1 < argc))
+			nThreads = std::max(1, atoi(argv[++i]));
+		else if ((std::strcmp(argv[i], "-r") == 0) && (i+1 < argc))
+			radii.push_back(atof(argv[++i]));
+		else if ((std::strcmp(argv[i], "-w") == 0) && (i+1 < argc))
+		{
+			if (!weights.parse(argv[++i]))
+			{
+				std::fprintf(stderr,"  invalid weights %s, need l,lx,w,wx.\n\n", argv[i]);
+				std::exit(1);
+			}
+		}
+		else
+			args.push_back(argv[i]);
+	}
+
+	if (radii.empty() && (args.size() >= 3))
+		radii.push_back(atof(args[2]));
 
-	if (argc <= 3)
+	if ((args.size() < 2) || radii.empty())
 	{
-		std::fprintf(stderr,"  You need to supply two image file name and a radius value\n\n");
+		std::fprintf(stderr,"  You need to supply two image file name and a radius value\n");
+		std::fprintf(stderr,"  options:\n");
+		std::fprintf(stderr,"    -c            check the vectorized classification against the scalar version\n");
+		std::fprintf(stderr,"    -j <threads>  number of threads (default: %d)\n", nThreads);
+		std::fprintf(stderr,"    -r <radius>   radius, can be given several times\n");
+		std::fprintf(stderr,"    -w <l,lx,w,wx> weights of the difference classes (default: 1,3,1,10)\n");
+		CompareReport::usage();
+		std::fprintf(stderr,"\n");
 		std::exit(1);
 	}
 
-	char *fnm_ref = argv[1];
-	char *fnm = argv[2];
-	float radius = atof(argv[3]);
+	char *fnm_ref = args[0];
+	char *fnm = args[1];
+	int nr = radii.size();
+	bool batch = (nr > 1);
+
+	// the distances are computed once for all radii, the histogram needs
+	// them for any radius
+	bool need_dist = report.histogram();
+	for (int r = 0; r < nr; r++)
+		need_dist = need_dist || (radii[r] > 0);
 
 	GDALAllRegister();
 
@@ -113,53 +189,154 @@ int main(int argc,char **argv)
 		std::exit(1);
 	}
 
+	const int nChunkRows = 64;
+
+	// the tiles of the report are whole chunks high and whole mask words wide
+	report.setup(PROGRAM_TITLE, fnm_ref, nXSize, nYSize, adfGeoTransform, poDataset_ref->GetProjectionRef(), nChunkRows);
+	TileStats *tiles = report.enabled() ? new TileStats(nXSize, nYSize, report.tile_size(), nChunkRows, nr) : NULL;
+	DistanceHistogram *hist = report.histogram() ? new DistanceHistogram(nYSize, nChunkRows) : NULL;
+
 	std::fprintf(stderr,"  allocating images (%dx%d)...\n", nXSize, nYSize);
+	profile().phase("allocating images");
 
-	CImg<unsigned char> img_ref = CImg<unsigned char>(nXSize,nYSize,1,1);
-	CImg<unsigned char> img = CImg<unsigned char>(nXSize,nYSize,1,1);
-	CImg<float> img_dist1;
-	CImg<float> img_dist2;
+	BitMask img_ref;
+	BitMask img;
 
 	std::fprintf(stderr,"  reading data...\n");
+	profile().phase("reading data");
+
+	// the candidate is read in the background while the reference is read
+	// and its distance field generated
+	IOThread reader;
+	reader.start([&]() { return img.read(poBand, nXSize, nYSize, 255); });
 
-	if( poBand_ref->RasterIO( GF_Read, 0, 0, nXSize, nYSize, img_ref.data(), nXSize, nYSize, GDT_Byte, 0, 0 ) != CE_None )
+	if (!img_ref.read(poBand_ref, nXSize, nYSize, 255))
 	{
 		std::fprintf(stderr,"  reading reference data failed.\n\n");
 		std::exit(1);
 	}
 
-	if( poBand->RasterIO( GF_Read, 0, 0, nXSize, nYSize, img.data(), nXSize, nYSize, GDT_Byte, 0, 0 ) != CE_None )
+	std::fprintf(stderr,"  generating distance field...\n");
+	profile().phase("generating distance field");
+
+	// squared distance to the nearest pixel of the other class in the
+	// reference mask, for negative radius distances are zero
+	std::vector<unsigned int> ref_dist2;
+	if (need_dist)
+		opposite_distance(img_ref.view(), nXSize, nYSize, ref_dist2);
+
+	if (!reader.wait())
 	{
 		std::fprintf(stderr,"  reading data failed.\n\n");
 		std::exit(1);
 	}
 
-	std::fprintf(stderr,"  generating distance fields...\n");
+	// the image is assumed to cover the whole world width with square pixels
+	// and to be centered at the equator
+	double pixel_size = 2.0*cimg::PI*EarthRadius/nXSize;
+	const double wm_transform[6] = { -cimg::PI*EarthRadius, pixel_size, 0.0, (nYSize/2)*pixel_size, 0.0, -pixel_size };
 
-	if (radius > 0)
-	{
-		img_dist1 = img_ref.get_distance(0);
-		img_dist2 = img_ref.get_distance(255);
-	}
-	else
+	const char *kernel_name;
+	ClassifyFunc classify = classify_kernel(&kernel_name);
+
+	std::fprintf(stderr,"  analyzing (%s kernel%s) using %d threads...\n", kernel_name, check ? ", checked" : "", nThreads);
+	profile().phase("analyzing");
+
+	// per row counts for every radius, the areas are added with tree_sum()
+	// in the end so the results do not depend on the number of threads
+	std::vector<ClassCounts> row_counts(size_t(nYSize)*nr);
+	std::vector<double> row_scale(nYSize);
+	std::atomic<bool> failed(false);
+
+	std::atomic<int> next_chunk(0);
+	int nChunks = (nYSize+nChunkRows-1)/nChunkRows;
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < nThreads; i++)
 	{
-		img_dist1 = img_ref.get_distance(255);
-		img_dist2 = img_ref.get_distance(0);
-	}
+		threads.push_back(std::thread([&]()
+		{
+			// the scale factors are the same along a row
+			WebMercatorBackend backend(EarthRadius);
+			ScaleFactorGrid grid(backend, wm_transform, 0.0);
+			std::vector<ScaleFactors> facs;
+
+			int c;
+			while (((c = next_chunk++) < nChunks) && !failed)
+			{
+				int y1 = c*nChunkRows;
+				int y2 = std::min(y1+nChunkRows, nYSize);
+				grid.fill(0, y1, 1, y2-y1, facs);
+
+				for (int py = y1; py < y2; py++)
+				{
+					double scale = facs[py-y1].h;
+					row_scale[py] = scale;
+
+					// the pixels of a row have the same area
+					size_t o = size_t(py)*nXSize;
+					double area = pixel_size*pixel_size/(scale*scale*1000*1000);
 
-	double pixel_size = 2.0*cimg::PI*EarthRadius/img.width();
+					if (hist)
+						DistanceHistogram::add_row(hist->chunk(py), img_ref.row(py), img.row(py), &ref_dist2[o], nXSize, pixel_size/scale, area);
 
-	std::fprintf(stderr,"  analyzing...\n");
+					// all radii are classified while the row is in cache
+					for (int r = 0; r < nr; r++)
+					{
+						// the threshold is constant along the row so the pixels are
+						// classified by comparing the squared distances with an integer limit
+						unsigned int limit = 0;
+						bool any = distance_limit(scale*std::abs(radii[r])/pixel_size, limit);
+
+						const unsigned int *dist2 = (radii[r] > 0) ? &ref_dist2[o] : NULL;
+
+						ClassCounts &cc = row_counts[size_t(py)*nr+r];
+						cc.l = cc.lx = cc.w = cc.wx = 0;
+						if (tiles)
+						{
+							// classified per tile
+							RowStats *ts = tiles->chunk(py);
+							for (int tx = 0; tx < tiles->cols(); tx++)
+							{
+								int x0 = tx*tiles->size();
+								int o0 = x0/BitMask::WordBits;
+								ClassCounts tc = { 0, 0, 0, 0 };
+								classify(img_ref.row(py)+o0, img.row(py)+o0, dist2 ? dist2+x0 : NULL, any, limit, std::min(tiles->size(), nXSize-x0), tc);
+								add_counts(ts[tx*nr+r], tc, area);
+								cc.l += tc.l;
+								cc.lx += tc.lx;
+								cc.w += tc.w;
+								cc.wx += tc.wx;
+							}
+						}
+						else
+							classify(img_ref.row(py), img.row(py), dist2, any, limit, nXSize, cc);
+
+						if (check)
+						{
+							ClassCounts cs = { 0, 0, 0, 0 };
+							classify_scalar(img_ref.row(py), img.row(py), dist2, any, limit, nXSize, cs);
+							if ((cc.l != cs.l) || (cc.lx != cs.lx) || (cc.w != cs.w) || (cc.wx != cs.wx))
+							{
+								std::fprintf(stderr,"  %s kernel differs from scalar version in row %d.\n", kernel_name, py);
+								failed = true;
+							}
+						}
+					}
+				}
+			}
+		}));
+	}
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
 
-	size_t cnt_l = 0;
-	size_t cnt_w = 0;
-	size_t cnt_lx = 0;
-	size_t cnt_wx = 0;
-	double area_l = 0.0;
-	double area_w = 0.0;
-	double area_lx = 0.0;
-	double area_wx = 0.0;
-	double area_all = 0.0;
+	profile().pixels(size_t(nXSize)*nYSize);
+
+	if (failed)
+	{
+		std::fprintf(stderr,"\n");
+		std::exit(1);
+	}
 
 	double min_scale = 1.0e12;
 	double max_scale = -1.0e12;
@@ -167,11 +344,15 @@ int main(int argc,char **argv)
 	double min_ascale = 1.0e12;
 	double max_ascale = -1.0e12;
 
+	// the area of a pixel is constant along a row so the row areas are
+	// single products
+	std::vector<double> row_area(nYSize), all(nYSize);
+
 	for (int py = 0; py < nYSize; py++)
 	{
-		double y = pixel_size*(0.5+py-img.height()/2);
-		double scale = std::cosh(y/6378137.0);
+		double scale = row_scale[py];
 		double ascale = scale*scale*1000*1000; // in sqm/sqkm
+		double area = pixel_size*pixel_size/ascale;
 
 		min_ascale = std::min(min_ascale, ascale*0.000001);
 		max_ascale = std::max(max_ascale, ascale*0.000001);
@@ -179,57 +360,85 @@ int main(int argc,char **argv)
 		min_scale = std::min(min_scale, scale);
 		max_scale = std::max(max_scale, scale);
 
-		for (int px = 0; px < nXSize; px++)
+		row_area[py] = area;
+		all[py] = area*nXSize;
+	}
+
+	double area_all = tree_sum(&all[0], nYSize);
+
+	std::fprintf(stderr,"maximum area scaling: %.4f, minimum: %.4f\n", max_ascale, min_ascale);
+	std::fprintf(stderr,"maximum scaling: %.4f, minimum scaling: %.4f\n", max_scale, min_scale);
+
+	std::vector<CompareStats> results(nr);
+	std::vector<double> l(nYSize), lx(nYSize), w(nYSize), wx(nYSize);
+
+	for (int r = 0; r < nr; r++)
+	{
+		CompareStats &cs = results[r];
+		std::memset(&cs, 0, sizeof(cs));
+
+		for (int py = 0; py < nYSize; py++)
 		{
-			area_all += pixel_size*pixel_size/ascale;
+			const ClassCounts &cc = row_counts[size_t(py)*nr+r];
 
-			if (img(px,py) == 255)
-			{
-				// new in mask pixel
-				if (img_ref(px,py) == 0)
-				{
-					if (img_dist2(px,py) < scale*std::abs(radius)/pixel_size)
-					{
-						cnt_l++;
-						area_l += pixel_size*pixel_size/ascale;
-					}
-					else
-					{
-						cnt_lx++;
-						area_lx += pixel_size*pixel_size/ascale;
-					}
-				}
-			}
-			else
-			{
-				// new out of mask pixel
-				if (img_ref(px,py) == 255)
-				{
-					if (img_dist1(px,py) < scale*std::abs(radius)/pixel_size)
-					{
-						cnt_w++;
-						area_w += pixel_size*pixel_size/ascale;
-					}
-					else
-					{
-						cnt_wx++;
-						area_wx += pixel_size*pixel_size/ascale;
-						}
-				}
-			}
+			cs.cnt_l += cc.l;
+			cs.cnt_lx += cc.lx;
+			cs.cnt_w += cc.w;
+			cs.cnt_wx += cc.wx;
+
+			l[py] = row_area[py]*cc.l;
+			lx[py] = row_area[py]*cc.lx;
+			w[py] = row_area[py]*cc.w;
+			wx[py] = row_area[py]*cc.wx;
 		}
+
+		cs.area_l = tree_sum(&l[0], nYSize);
+		cs.area_lx = tree_sum(&lx[0], nYSize);
+		cs.area_w = tree_sum(&w[0], nYSize);
+		cs.area_wx = tree_sum(&wx[0], nYSize);
+
+		double area_weighted = weighted_area(cs, weights);
+
+		if (batch)
+			std::fprintf(stderr,"%s, radius %.2f:\n", fnm, radii[r]);
+		std::fprintf(stderr,"new in mask: %ld normal pixel (%.2f sqkm)\n", cs.cnt_l, cs.area_l);
+		std::fprintf(stderr,"             %ld isolated pixel (%.2f sqkm)\n", cs.cnt_lx, cs.area_lx);
+		std::fprintf(stderr,"new out of mask: %ld normal pixel (%.2f sqkm)\n", cs.cnt_w, cs.area_w);
+		std::fprintf(stderr,"                 %ld isolated pixel (%.2f sqkm)\n", cs.cnt_wx, cs.area_wx);
+		std::fprintf(stderr,"difference rating: %.9f (%.2f sqkm)\n", area_weighted/area_all, area_weighted);
+
+		// with several radii the radius and file name are appended like in gdal_maskcompare
+		if (batch)
+			std::fprintf(stdout,"short version: %ld:%.2f:%ld:%.2f:%ld:%.2f:%ld:%.2f:%.9f:%.2f:%g:%s\n", cs.cnt_l, cs.area_l, cs.cnt_lx, cs.area_lx, cs.cnt_w, cs.area_w, cs.cnt_wx, cs.area_wx, area_weighted/area_all, area_weighted, radii[r], fnm);
+		else
+			std::fprintf(stdout,"short version: %ld:%.2f:%ld:%.2f:%ld:%.2f:%ld:%.2f:%.9f:%.2f\n", cs.cnt_l, cs.area_l, cs.cnt_lx, cs.area_lx, cs.cnt_w, cs.area_w, cs.cnt_wx, cs.area_wx, area_weighted/area_all, area_weighted);
 	}
 
-	double area_weighted = area_l+area_w+3.0*area_lx+10.0*area_wx;
+	if (report.enabled() || report.histogram())
+	{
+		report.set_area(area_all);
+		report.set_weights(weights);
 
-	std::fprintf(stderr,"maximum area scaling: %.4f, minimum: %.4f\n", max_ascale, min_ascale);
-	std::fprintf(stderr,"maximum scaling: %.4f, minimum scaling: %.4f\n", max_scale, min_scale);
+		if (tiles)
+		{
+			std::vector<CompareStats> tile_results(report.tiles());
+			for (int r = 0; r < nr; r++)
+			{
+				tiles->merge(r, &tile_results[0]);
+				report.add(fnm, radii[r], results[r], &tile_results[0]);
+			}
+			delete tiles;
+		}
 
-	std::fprintf(stderr,"new in mask: %ld normal pixel (%.2f sqkm)\n", cnt_l, area_l);
-	std::fprintf(stderr,"             %ld isolated pixel (%.2f sqkm)\n", cnt_lx, area_lx);
-	std::fprintf(stderr,"new out of mask: %ld normal pixel (%.2f sqkm)\n", cnt_w, area_w);
-	std::fprintf(stderr,"                 %ld isolated pixel (%.2f sqkm)\n", cnt_wx, area_wx);
-	std::fprintf(stderr,"difference rating: %.9f (%.2f sqkm)\n", area_weighted/area_all, area_weighted);
-	std::fprintf(stdout,"short version: %ld:%.2f:%ld:%.2f:%ld:%.2f:%ld:%.2f:%.9f:%.2f\n", cnt_l, area_l, cnt_lx, area_lx, cnt_w, area_w, cnt_wx, area_wx, area_weighted/area_all, area_weighted);
+		if (hist)
+		{
+			std::vector<HistogramStats> bins(DistanceHistogram::Bins);
+			hist->merge(&bins[0]);
+			report.add_histogram(fnm, &bins[0]);
+			delete hist;
+		}
 
+		if (!report.write())
+			std::exit(1);
+	}
 }
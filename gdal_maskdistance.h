@@ -0,0 +1,353 @@
+/* ========================================================================
+    File: @(#)gdal_maskdistance.h
+   ------------------------------------------------------------------------
+    distance transforms of black/white masks for the gdal-tools
+    Copyright (C) 2014-2015 Christoph Hormann <chris_hormann@gmx.de>
+   ------------------------------------------------------------------------
+
+    This file is part of gdal-tools
+
+    gdal-tools is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gdal-tools is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gdal-tools.  If not, see <http://www.gnu.org/licenses/>.
+
+   ========================================================================
+ */
+
+#ifndef GDAL_MASKDISTANCE_H
+#define GDAL_MASKDISTANCE_H
+
+#include <cstddef>
+#include <climits>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+// view of a byte mask with rows stride bytes apart, pixels of value val are
+// set; BitMask::view() is the same for bit packed masks
+struct ByteMask
+{
+	ByteMask(const unsigned char *img, size_t stride, unsigned char val): Img(img), Stride(stride), Val(val) {}
+
+	bool operator()(int x, int y) const { return Img[y*Stride + x] == Val; }
+
+	const unsigned char *Img;
+	size_t Stride;
+	unsigned char Val;
+};
+
+// pixel of a row with its squared distance to the nearest feature pixel
+struct DistancePixel
+{
+	int x;
+	unsigned int d2;
+};
+
+struct BoundedDistanceBase
+{
+	enum { Inf = 0xFFFF };
+};
+
+// Euclidean distance to the nearest set pixel for all other pixels of a
+// mask view (ByteMask or BitMask::View), limited to a maximum distance cap (< 65535 pixels).
+//
+// The nearest set pixel is always at the edge of a set region so
+// only edge pixels are used as sites.  The vertical distances to the
+// nearest site are determined in two sweeps over the image and stored as
+// 16 bit values, saturated at cap.  The horizontal pass (lower envelope of
+// parabolas, Felzenszwalb/Huttenlocher) is done per row on demand and only
+// involves the sites within cap rows so rows far from any edge cost next
+// to nothing.
+template <class Mask>
+class BoundedDistance: public BoundedDistanceBase
+{
+public:
+	// mask is a view of a w x h mask
+	BoundedDistance(const Mask &mask, int w, int h, int cap):
+		M(mask), W(w), H(h), Cap(cap), G(size_t(w)*h)
+	{
+		// top down sweep
+		for (int y = 0; y < H; y++)
+		{
+			unsigned short *g = &G[size_t(y)*W];
+			const unsigned short *gp = (y > 0) ? &G[size_t(y-1)*W] : NULL;
+			for (int x = 0; x < W; x++)
+			{
+				if (site(x, y))
+					g[x] = 0;
+				else if (gp && (gp[x] < Cap))
+					g[x] = gp[x]+1;
+				else
+					g[x] = Inf;
+			}
+		}
+
+		// bottom up sweep
+		for (int y = H-2; y >= 0; y--)
+		{
+			unsigned short *g = &G[size_t(y)*W];
+			const unsigned short *gn = &G[size_t(y+1)*W];
+			for (int x = 0; x < W; x++)
+				if ((gn[x] < Cap) && (gn[x]+1 < g[x]))
+					g[x] = gn[x]+1;
+		}
+	}
+
+	// pixels of row y in [x1,x2) not set within cap of a set pixel
+	void row(int y, int x1, int x2, std::vector<DistancePixel> &out)
+	{
+		out.clear();
+
+		const unsigned short *g = &G[size_t(y)*W];
+
+		Sites.clear();
+		for (int x = std::max(0, x1-Cap); x < std::min(W, x2+Cap); x++)
+			if (g[x] != Inf)
+				Sites.push_back(x);
+
+		if (Sites.empty())
+			return;
+
+		// lower envelope of the parabolas (x-q)^2 + g(q)^2
+		size_t n = Sites.size();
+		V.resize(n);
+		Z.resize(n+1);
+		size_t k = 0;
+		V[0] = Sites[0];
+		Z[0] = -std::numeric_limits<double>::max();
+		Z[1] = std::numeric_limits<double>::max();
+		for (size_t i = 1; i < n; i++)
+		{
+			int q = Sites[i];
+			double s = intersection(g, q, V[k]);
+			while (s <= Z[k])
+			{
+				k--;
+				s = intersection(g, q, V[k]);
+			}
+			k++;
+			V[k] = q;
+			Z[k] = s;
+			Z[k+1] = std::numeric_limits<double>::max();
+		}
+
+		const unsigned long long cap2 = (unsigned long long)Cap*Cap;
+		int xs = std::max(x1, Sites.front()-Cap);
+		int xe = std::min(x2, Sites.back()+Cap+1);
+
+		k = 0;
+		for (int x = xs; x < xe; x++)
+		{
+			while (Z[k+1] < x)
+				k++;
+			if (M(x, y))
+				continue;
+			// the nearest site can be more than cap pixels away horizontally,
+			// the squared distance is determined in 64 bit so it can not wrap
+			long long dx = x-V[k];
+			if ((dx > Cap) || (dx < -Cap))
+				continue;
+			unsigned long long d2 = (unsigned long long)(dx*dx) + (unsigned long long)g[V[k]]*g[V[k]];
+			if (d2 <= cap2)
+			{
+				DistancePixel p;
+				p.x = x;
+				p.d2 = (unsigned int)d2;
+				out.push_back(p);
+			}
+		}
+	}
+
+private:
+	Mask M;
+	int W, H;
+	int Cap;
+
+	// vertical distance to the nearest site
+	std::vector<unsigned short> G;
+
+	std::vector<int> Sites;
+	std::vector<int> V;
+	std::vector<double> Z;
+
+	// intersection of the parabolas of sites q and v
+	static double intersection(const unsigned short *g, int q, int v)
+	{
+		return ((double(g[q])*g[q] + double(q)*q) - (double(g[v])*g[v] + double(v)*v)) / (2.0*(q-v));
+	}
+
+	// set pixel with a 4-neighbor not set
+	bool site(int x, int y) const
+	{
+		if (!M(x, y))
+			return false;
+		if ((x > 0) && !M(x-1, y))
+			return true;
+		if ((x < W-1) && !M(x+1, y))
+			return true;
+		if ((y > 0) && !M(x, y-1))
+			return true;
+		if ((y < H-1) && !M(x, y+1))
+			return true;
+		return false;
+	}
+};
+
+// one dimensional squared distance transform d[x] = min_q (x-q)^2 + f[q]
+// (lower envelope of parabolas, Felzenszwalb/Huttenlocher), positions with
+// f[q] = ULLONG_MAX are no sites.  v and z are work buffers.
+inline void distance_transform_1d(const unsigned long long *f, int n, unsigned long long *d,
+                                  std::vector<int> &v, std::vector<double> &z)
+{
+	v.resize(n);
+	z.resize(n+1);
+
+	int k = -1;
+	for (int q = 0; q < n; q++)
+	{
+		if (f[q] == ULLONG_MAX)
+			continue;
+		if (k < 0)
+		{
+			k = 0;
+			v[0] = q;
+			z[0] = -std::numeric_limits<double>::max();
+			z[1] = std::numeric_limits<double>::max();
+			continue;
+		}
+		double s = ((double(f[q]) + double(q)*q) - (double(f[v[k]]) + double(v[k])*v[k])) / (2.0*(q-v[k]));
+		while (s <= z[k])
+		{
+			k--;
+			s = ((double(f[q]) + double(q)*q) - (double(f[v[k]]) + double(v[k])*v[k])) / (2.0*(q-v[k]));
+		}
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k+1] = std::numeric_limits<double>::max();
+	}
+
+	if (k < 0)
+	{
+		std::fill(d, d+n, ULLONG_MAX);
+		return;
+	}
+
+	k = 0;
+	for (int x = 0; x < n; x++)
+	{
+		while (z[k+1] < x)
+			k++;
+		long long dx = x-v[k];
+		d[x] = (unsigned long long)(dx*dx) + f[v[k]];
+	}
+}
+
+// Squared Euclidean distance of every pixel of a w x h mask view to the
+// nearest pixel of the other class (set vs. not set pixels) in a single
+// transform for both classes.  The vertical distances to the nearest
+// pixel of the other class are determined in two sweeps tracking the last
+// position of both classes per column and are then replaced in place row by
+// row with the result of the horizontal pass.  Distances are saturated at
+// UINT_MAX, pixels without any pixel of the other class get UINT_MAX.
+template <class Mask>
+inline void opposite_distance(const Mask &mask, int w, int h, std::vector<unsigned int> &d2)
+{
+	d2.resize(size_t(w)*h);
+
+	// top down sweep
+	{
+		std::vector<int> last_in(w, -1);
+		std::vector<int> last_out(w, -1);
+
+		for (int y = 0; y < h; y++)
+		{
+			unsigned int *g = &d2[size_t(y)*w];
+			for (int x = 0; x < w; x++)
+			{
+				if (mask(x, y))
+				{
+					last_in[x] = y;
+					g[x] = (last_out[x] >= 0) ? y-last_out[x] : UINT_MAX;
+				}
+				else
+				{
+					last_out[x] = y;
+					g[x] = (last_in[x] >= 0) ? y-last_in[x] : UINT_MAX;
+				}
+			}
+		}
+	}
+
+	// bottom up sweep
+	{
+		std::vector<int> next_in(w, -1);
+		std::vector<int> next_out(w, -1);
+
+		for (int y = h-1; y >= 0; y--)
+		{
+			unsigned int *g = &d2[size_t(y)*w];
+			for (int x = 0; x < w; x++)
+			{
+				if (mask(x, y))
+				{
+					next_in[x] = y;
+					if (next_out[x] >= 0)
+						g[x] = std::min(g[x], (unsigned int)(next_out[x]-y));
+				}
+				else
+				{
+					next_out[x] = y;
+					if (next_in[x] >= 0)
+						g[x] = std::min(g[x], (unsigned int)(next_in[x]-y));
+				}
+			}
+		}
+	}
+
+	// horizontal pass, f_in/f_out are the squared vertical distances to the
+	// nearest set/not set pixel
+	std::vector<unsigned long long> f_in(w), f_out(w), d_in(w), d_out(w);
+	std::vector<int> v;
+	std::vector<double> z;
+
+	for (int y = 0; y < h; y++)
+	{
+		unsigned int *g = &d2[size_t(y)*w];
+
+		for (int x = 0; x < w; x++)
+		{
+			unsigned long long gg = (g[x] == UINT_MAX) ? ULLONG_MAX : (unsigned long long)g[x]*g[x];
+			if (mask(x, y))
+			{
+				f_in[x] = 0;
+				f_out[x] = gg;
+			}
+			else
+			{
+				f_in[x] = gg;
+				f_out[x] = 0;
+			}
+		}
+
+		distance_transform_1d(&f_in[0], w, &d_in[0], v, z);
+		distance_transform_1d(&f_out[0], w, &d_out[0], v, z);
+
+		for (int x = 0; x < w; x++)
+		{
+			unsigned long long d = mask(x, y) ? d_out[x] : d_in[x];
+			g[x] = (unsigned int)std::min(d, (unsigned long long)UINT_MAX);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,247 @@
+/* ========================================================================
+    File: @(#)gdal_maskindex.h
+   ------------------------------------------------------------------------
+    precomputed reference mask index for gdal_maskcompare
+    Copyright (C) 2014-2015 Christoph Hormann <chris_hormann@gmx.de>
+   ------------------------------------------------------------------------
+
+    This file is part of gdal-tools
+
+    gdal-tools is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gdal-tools is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gdal-tools.  If not, see <http://www.gnu.org/licenses/>.
+
+   ========================================================================
+ */
+
+#ifndef GDAL_MASKINDEX_H
+#define GDAL_MASKINDEX_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// scale factors of a pixel as used by the comparison, scale <= 0 marks a
+// pixel where the factors could not be determined
+struct CompareFactors
+{
+	double scale;  // max(h,k)
+	double ascale; // areal scale in sqm/sqkm
+};
+
+// the factors as stored in the index, single precision halves its size
+struct IndexFactors
+{
+	float scale;
+	float ascale;
+};
+
+inline IndexFactors index_factors(const CompareFactors &f)
+{
+	IndexFactors i = { float(f.scale), float(f.ascale) };
+	return i;
+}
+
+// statistics of the reference scale factors independent of the candidate
+struct ReferenceStats
+{
+	double area_all;
+	double min_scale;
+	double max_scale;
+	double min_ascale;
+	double max_ascale;
+	unsigned long long cnterr;
+};
+
+// fixed size file header, followed by the proj4 string and the path of
+// the reference file, each padded to 8 bytes, the factors (one per row in
+// row mode, otherwise one per pixel), the squared distances to the other
+// class padded to 8 bytes and the reference mask itself, bit packed in rows
+// of 64 bit words like BitMask.  The reference file is identified by its
+// canonical path, size, modification time, raster size and geotransform.
+struct MaskIndexHeader
+{
+	char magic[8];
+	int width;
+	int height;
+	int row_mode;
+	int proj4_len;
+	int reference_len;
+	int reserved;
+	long long reference_size;
+	long long reference_mtime;
+	double geotransform[6];
+	double tolerance;
+	double pixel_size;
+	ReferenceStats stats;
+};
+
+static const char MaskIndexMagic[8] = { 'G', 'D', 'M', 'C', 'I', 'D', 'X', '4' };
+
+// canonical path, size and modification time of a reference file, returns
+// false if it does not exist
+inline bool reference_file(const char *fnm, std::string &path, long long &size, long long &mtime)
+{
+	struct stat st;
+	if (stat(fnm, &st) != 0)
+		return false;
+
+	char *p = realpath(fnm, NULL);
+	path = p ? p : fnm;
+	std::free(p);
+
+	size = st.st_size;
+	mtime = st.st_mtime;
+	return true;
+}
+
+// sections are written in sequence with MaskIndexWriter and the header is
+// completed at the end once the statistics are known
+class MaskIndexWriter
+{
+public:
+	MaskIndexWriter(): File(NULL) {}
+	~MaskIndexWriter() { if (File) std::fclose(File); }
+
+	bool create(const char *fnm, const MaskIndexHeader &hdr, const char *proj4, const std::string &reference)
+	{
+		File = std::fopen(fnm, "wb");
+		if (!File)
+			return false;
+
+		Hdr = hdr;
+		std::memcpy(Hdr.magic, MaskIndexMagic, sizeof(Hdr.magic));
+		Hdr.proj4_len = std::strlen(proj4);
+		Hdr.reference_len = reference.size();
+
+		return write(&Hdr, sizeof(Hdr)) && write_padded(proj4, Hdr.proj4_len) &&
+		       write_padded(reference.data(), reference.size());
+	}
+
+	bool write(const void *data, size_t size)
+	{
+		return std::fwrite(data, 1, size, File) == size;
+	}
+
+	bool finish(const ReferenceStats &stats)
+	{
+		Hdr.stats = stats;
+		bool ok = (std::fseek(File, 0, SEEK_SET) == 0) && write(&Hdr, sizeof(Hdr));
+		ok = (std::fclose(File) == 0) && ok;
+		File = NULL;
+		return ok;
+	}
+
+	// write and pad with zeros to a multiple of 8 bytes
+	bool write_padded(const void *data, size_t size)
+	{
+		static const char zero[8] = { 0 };
+		return write(data, size) && write(zero, padded(size)-size);
+	}
+
+	static size_t padded(size_t n) { return (n+7) & ~size_t(7); }
+
+private:
+	std::FILE *File;
+	MaskIndexHeader Hdr;
+};
+
+// read only memory mapping of an index file
+class MaskIndex
+{
+public:
+	MaskIndex(): Map(NULL), MapSize(0) {}
+	~MaskIndex() { unmap(); }
+
+	// returns false if the file does not exist or is not a valid index
+	bool map(const char *fnm)
+	{
+		int fd = ::open(fnm, O_RDONLY);
+		if (fd < 0)
+			return false;
+
+		struct stat st;
+		if ((fstat(fd, &st) != 0) || (size_t(st.st_size) < sizeof(MaskIndexHeader)))
+		{
+			::close(fd);
+			return false;
+		}
+
+		MapSize = st.st_size;
+		void *p = mmap(NULL, MapSize, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (p == MAP_FAILED)
+			return false;
+		Map = (const char *)p;
+
+		const MaskIndexHeader &hdr = header();
+		if ((std::memcmp(hdr.magic, MaskIndexMagic, sizeof(hdr.magic)) != 0) || (hdr.proj4_len < 0) || (hdr.reference_len < 0))
+		{
+			unmap();
+			return false;
+		}
+
+		size_t n = size_t(hdr.width)*hdr.height;
+		size_t nfacs = hdr.row_mode ? size_t(hdr.height) : n;
+		RefOffset = sizeof(MaskIndexHeader) + MaskIndexWriter::padded(hdr.proj4_len);
+		FacsOffset = RefOffset + MaskIndexWriter::padded(hdr.reference_len);
+		DistOffset = FacsOffset + nfacs*sizeof(IndexFactors);
+		MaskOffset = DistOffset + MaskIndexWriter::padded(n*sizeof(unsigned int));
+
+		if (MaskOffset + size_t(hdr.height)*mask_words()*sizeof(unsigned long long) != MapSize)
+		{
+			unmap();
+			return false;
+		}
+
+		// the comparison is a single linear scan
+		madvise((void *)Map, MapSize, MADV_SEQUENTIAL);
+		return true;
+	}
+
+	void unmap()
+	{
+		if (Map)
+			munmap((void *)Map, MapSize);
+		Map = NULL;
+	}
+
+	const MaskIndexHeader &header() const { return *(const MaskIndexHeader *)Map; }
+	std::string proj4() const { return std::string(Map + sizeof(MaskIndexHeader), header().proj4_len); }
+	std::string reference() const { return std::string(Map + RefOffset, header().reference_len); }
+
+	// factors of row py, in row mode a single value for the whole row
+	const IndexFactors *factors(int py) const
+	{
+		const IndexFactors *f = (const IndexFactors *)(Map + FacsOffset);
+		return header().row_mode ? f + py : f + size_t(py)*header().width;
+	}
+	const unsigned int *dist2(int py) const { return (const unsigned int *)(Map + DistOffset) + size_t(py)*header().width; }
+	const unsigned long long *mask(int py) const { return (const unsigned long long *)(Map + MaskOffset) + size_t(py)*mask_words(); }
+	size_t mask_words() const { return (size_t(header().width)+63)/64; }
+
+private:
+	const char *Map;
+	size_t MapSize;
+	size_t RefOffset;
+	size_t FacsOffset;
+	size_t DistOffset;
+	size_t MaskOffset;
+};
+
+#endif
@@ -0,0 +1,241 @@
+/* ========================================================================
+    File: @(#)gdal_maskkernel.h
+   ------------------------------------------------------------------------
+    classification and area summation of mask differences for the gdal-tools
+    Copyright (C) 2014-2015 Christoph Hormann <chris_hormann@gmx.de>
+   ------------------------------------------------------------------------
+
+    This file is part of gdal-tools
+
+    gdal-tools is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gdal-tools is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gdal-tools.  If not, see <http://www.gnu.org/licenses/>.
+
+   ========================================================================
+ */
+
+#ifndef GDAL_MASKKERNEL_H
+#define GDAL_MASKKERNEL_H
+
+#include <cstddef>
+#include <climits>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MASKKERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+// counts of the classes of difference pixels in a row
+struct ClassCounts
+{
+	size_t l;  // new in mask, normal
+	size_t lx; // new in mask, isolated
+	size_t w;  // new out of mask, normal
+	size_t wx; // new out of mask, isolated
+};
+
+// The comparison float(sqrt(d2)) < threshold is monotonic in the squared
+// distance d2 so it is equivalent to d2 <= limit with limit the largest
+// value passing it.  Returns false if not even d2 = 0 passes.
+inline bool distance_limit(double threshold, unsigned int &limit)
+{
+	if (!(0.0f < threshold))
+		return false;
+
+	unsigned long long d = (unsigned long long)std::min(threshold*threshold, double(UINT_MAX));
+	while ((d < UINT_MAX) && (float(std::sqrt(double(d+1))) < threshold))
+		d++;
+	while (!(float(std::sqrt(double(d))) < threshold))
+		d--;
+
+	limit = d;
+	return true;
+}
+
+// Classify pixels [0,n) of a row of bit masks (rows of 64 bit words as in
+// BitMask): pixels set in cand and not in ref are new in mask, pixels set in
+// ref and not in cand new out of mask.  They are normal if any is set and
+// dist2 <= limit (or dist2 is NULL).
+typedef void (*ClassifyFunc)(const unsigned long long *ref, const unsigned long long *cand, const unsigned int *dist2,
+                             bool any, unsigned int limit, int n, ClassCounts &c);
+
+// bits of the 64 pixels of a word with dist2 <= limit, only the pixels set
+// in diff are looked at and the others are undefined
+typedef unsigned long long (*NormalFunc)(const unsigned int *dist2, unsigned long long diff, unsigned int limit);
+
+inline unsigned long long normal_scalar(const unsigned int *dist2, unsigned long long diff, unsigned int limit)
+{
+	unsigned long long mn = 0;
+	while (diff)
+	{
+		int b = __builtin_ctzll(diff);
+		diff &= diff-1;
+		mn |= (unsigned long long)(dist2[b] <= limit) << b;
+	}
+	return mn;
+}
+
+// The masks are classified a word at a time, words without differences are
+// skipped and the distances are only looked at for words with differences.
+// The last word of a row can be partial so its distances are always looked
+// at individually.
+template <NormalFunc normal>
+__attribute__((always_inline))
+inline void classify_words(const unsigned long long *ref, const unsigned long long *cand, const unsigned int *dist2,
+                           bool any, unsigned int limit, int n, ClassCounts &c)
+{
+	int nw = (n+63)/64;
+	for (int i = 0; i < nw; i++)
+	{
+		unsigned long long ml = cand[i] & ~ref[i];
+		unsigned long long mw = ref[i] & ~cand[i];
+
+		if ((ml | mw) == 0)
+			continue;
+
+		unsigned long long mn = 0;
+		if (any)
+		{
+			if (!dist2)
+				mn = ~0ULL;
+			else if ((i+1)*64 <= n)
+				mn = normal(dist2+i*64, ml | mw, limit);
+			else
+				mn = normal_scalar(dist2+i*64, ml | mw, limit);
+		}
+
+		c.l += __builtin_popcountll(ml & mn);
+		c.lx += __builtin_popcountll(ml & ~mn);
+		c.w += __builtin_popcountll(mw & mn);
+		c.wx += __builtin_popcountll(mw & ~mn);
+	}
+}
+
+inline void classify_scalar(const unsigned long long *ref, const unsigned long long *cand, const unsigned int *dist2,
+                            bool any, unsigned int limit, int n, ClassCounts &c)
+{
+	classify_words<normal_scalar>(ref, cand, dist2, any, limit, n, c);
+}
+
+#ifdef MASKKERNEL_X86
+
+// all 64 distances compared 4 at a time as signed values after flipping the
+// sign bit, the results are packed into bytes for the movemask
+__attribute__((target("sse2")))
+static inline unsigned long long normal_sse2(const unsigned int *dist2, unsigned long long, unsigned int limit)
+{
+	const __m128i bias = _mm_set1_epi32(INT_MIN);
+	const __m128i lim = _mm_set1_epi32(int(limit ^ 0x80000000u));
+
+	unsigned long long gt = 0;
+	for (int k = 0; k < 4; k++)
+	{
+		const __m128i *d = (const __m128i *)(dist2+16*k);
+		__m128i g0 = _mm_cmpgt_epi32(_mm_xor_si128(_mm_loadu_si128(d), bias), lim);
+		__m128i g1 = _mm_cmpgt_epi32(_mm_xor_si128(_mm_loadu_si128(d+1), bias), lim);
+		__m128i g2 = _mm_cmpgt_epi32(_mm_xor_si128(_mm_loadu_si128(d+2), bias), lim);
+		__m128i g3 = _mm_cmpgt_epi32(_mm_xor_si128(_mm_loadu_si128(d+3), bias), lim);
+		__m128i g = _mm_packs_epi16(_mm_packs_epi32(g0, g1), _mm_packs_epi32(g2, g3));
+		gt |= (unsigned long long)(unsigned int)_mm_movemask_epi8(g) << (16*k);
+	}
+	return ~gt;
+}
+
+__attribute__((target("sse2")))
+static inline void classify_sse2(const unsigned long long *ref, const unsigned long long *cand, const unsigned int *dist2,
+                                 bool any, unsigned int limit, int n, ClassCounts &c)
+{
+	classify_words<normal_sse2>(ref, cand, dist2, any, limit, n, c);
+}
+
+// same with 8 distances at once, the packed comparison results are permuted
+// back into pixel order since the pack instructions work per 128 bit lane
+__attribute__((target("avx2,popcnt")))
+static inline unsigned long long normal_avx2(const unsigned int *dist2, unsigned long long, unsigned int limit)
+{
+	const __m256i bias = _mm256_set1_epi32(INT_MIN);
+	const __m256i lim = _mm256_set1_epi32(int(limit ^ 0x80000000u));
+	const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	unsigned long long gt = 0;
+	for (int k = 0; k < 2; k++)
+	{
+		const __m256i *d = (const __m256i *)(dist2+32*k);
+		__m256i g0 = _mm256_cmpgt_epi32(_mm256_xor_si256(_mm256_loadu_si256(d), bias), lim);
+		__m256i g1 = _mm256_cmpgt_epi32(_mm256_xor_si256(_mm256_loadu_si256(d+1), bias), lim);
+		__m256i g2 = _mm256_cmpgt_epi32(_mm256_xor_si256(_mm256_loadu_si256(d+2), bias), lim);
+		__m256i g3 = _mm256_cmpgt_epi32(_mm256_xor_si256(_mm256_loadu_si256(d+3), bias), lim);
+		__m256i g = _mm256_packs_epi16(_mm256_packs_epi32(g0, g1), _mm256_packs_epi32(g2, g3));
+		gt |= (unsigned long long)(unsigned int)_mm256_movemask_epi8(_mm256_permutevar8x32_epi32(g, order)) << (32*k);
+	}
+	return ~gt;
+}
+
+__attribute__((target("avx2,popcnt")))
+static inline void classify_avx2(const unsigned long long *ref, const unsigned long long *cand, const unsigned int *dist2,
+                                 bool any, unsigned int limit, int n, ClassCounts &c)
+{
+	classify_words<normal_avx2>(ref, cand, dist2, any, limit, n, c);
+}
+
+#endif
+
+// compensated (Kahan) summation for the per row partial sums
+struct KahanSum
+{
+	double sum;
+	double c;
+
+	void add(double v)
+	{
+		double y = v - c;
+		double t = sum + y;
+		c = (t - sum) - y;
+		sum = t;
+	}
+};
+
+// pairwise summation of n values, the order of the additions only depends
+// on n so sums of per row values do not depend on how the rows were processed
+inline double tree_sum(const double *v, size_t n)
+{
+	if (n == 0)
+		return 0.0;
+	if (n == 1)
+		return v[0];
+	size_t h = n/2;
+	return tree_sum(v, h) + tree_sum(v+h, n-h);
+}
+
+// best kernel supported by the CPU
+inline ClassifyFunc classify_kernel(const char **name)
+{
+#ifdef MASKKERNEL_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+	{
+		*name = "AVX2";
+		return classify_avx2;
+	}
+	if (__builtin_cpu_supports("sse2"))
+	{
+		*name = "SSE2";
+		return classify_sse2;
+	}
+#endif
+	*name = "scalar";
+	return classify_scalar;
+}
+
+#endif
@@ -0,0 +1,643 @@
+/* ========================================================================
+    File: @(#)gdal_maskreport.h
+   ------------------------------------------------------------------------
+    structured results of the mask comparison tools
+    Copyright (C) 2014-2015 Christoph Hormann <chris_hormann@gmx.de>
+   ------------------------------------------------------------------------
+
+    This file is part of gdal-tools
+
+    gdal-tools is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gdal-tools is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gdal-tools.  If not, see <http://www.gnu.org/licenses/>.
+
+   ========================================================================
+ */
+
+#ifndef GDAL_MASKREPORT_H
+#define GDAL_MASKREPORT_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <gdal_priv.h>
+
+#include "gdal_maskkernel.h"
+
+// counts and areas of the differences between candidate and reference
+struct CompareStats
+{
+	size_t cnt_l;
+	size_t cnt_w;
+	size_t cnt_lx;
+	size_t cnt_wx;
+	double area_l;
+	double area_w;
+	double area_lx;
+	double area_wx;
+};
+
+// counts and compensated area sums of the differences in a single row or
+// chunk of rows, the areas of all rows are added with tree_sum() in the end
+// so the results do not depend on the number of threads
+struct RowStats
+{
+	size_t cnt_l;
+	size_t cnt_w;
+	size_t cnt_lx;
+	size_t cnt_wx;
+	KahanSum area_l;
+	KahanSum area_w;
+	KahanSum area_lx;
+	KahanSum area_wx;
+};
+
+// add the counts of a row or part of it with pixels of the same area
+inline void add_counts(RowStats &rs, const ClassCounts &c, double area)
+{
+	rs.cnt_l += c.l;
+	rs.cnt_lx += c.lx;
+	rs.cnt_w += c.w;
+	rs.cnt_wx += c.wx;
+	rs.area_l.add(area*c.l);
+	rs.area_lx.add(area*c.lx);
+	rs.area_w.add(area*c.w);
+	rs.area_wx.add(area*c.wx);
+}
+
+// weights of the difference classes in the rating, isolated pixels (far
+// from the reference mask edge) count more than normal ones by default
+struct CompareWeights
+{
+	double l;
+	double lx;
+	double w;
+	double wx;
+
+	CompareWeights(): l(1.0), lx(3.0), w(1.0), wx(10.0) {}
+
+	// parse weights given as l,lx,w,wx, returns false if invalid
+	bool parse(const char *s)
+	{
+		char c;
+		return std::sscanf(s, "%lf,%lf,%lf,%lf%c", &l, &lx, &w, &wx, &c) == 4;
+	}
+};
+
+// weighted area of the differences the rating is based on
+inline double weighted_area(const CompareStats &cs, const CompareWeights &wt)
+{
+	return wt.l*cs.area_l+wt.w*cs.area_w+wt.lx*cs.area_lx+wt.wx*cs.area_wx;
+}
+
+// Differences per tile of size x size pixels for nr radii.  The rows are
+// compared in chunks of chunk_rows rows by several threads, with the tile
+// size a multiple of chunk_rows every chunk belongs to a single row of
+// tiles.  The statistics are collected per chunk and tile column and added
+// up per tile in a fixed order in the end like the rows for the totals.
+class TileStats
+{
+public:
+	TileStats(int width, int height, int size, int chunk_rows, int nr):
+		Size(size), ChunkRows(chunk_rows), NR(nr)
+	{
+		Cols = (width+size-1)/size;
+		Rows = (height+size-1)/size;
+		NChunks = (height+chunk_rows-1)/chunk_rows;
+		Chunks.resize(NChunks*Cols*nr);
+		std::memset(&Chunks[0], 0, sizeof(RowStats)*Chunks.size());
+	}
+
+	int size() const { return Size; }
+	int cols() const { return Cols; }
+	int rows() const { return Rows; }
+
+	// statistics of the chunk containing row y, nr per tile column
+	RowStats *chunk(int y) { return &Chunks[size_t(y/ChunkRows)*Cols*NR]; }
+
+	// totals of the tiles for radius r in row major order
+	void merge(int r, CompareStats *tiles) const
+	{
+		int per_tile = Size/ChunkRows;
+		std::vector<double> l(per_tile), w(per_tile), lx(per_tile), wx(per_tile);
+
+		for (int ty = 0; ty < Rows; ty++)
+			for (int tx = 0; tx < Cols; tx++)
+			{
+				CompareStats &cs = tiles[size_t(ty)*Cols+tx];
+				std::memset(&cs, 0, sizeof(cs));
+
+				int c0 = ty*per_tile;
+				int n = std::min(per_tile, NChunks-c0);
+				for (int c = 0; c < n; c++)
+				{
+					const RowStats &rs = Chunks[(size_t(c0+c)*Cols+tx)*NR+r];
+					cs.cnt_l += rs.cnt_l;
+					cs.cnt_w += rs.cnt_w;
+					cs.cnt_lx += rs.cnt_lx;
+					cs.cnt_wx += rs.cnt_wx;
+					l[c] = rs.area_l.sum;
+					w[c] = rs.area_w.sum;
+					lx[c] = rs.area_lx.sum;
+					wx[c] = rs.area_wx.sum;
+				}
+
+				cs.area_l = tree_sum(&l[0], n);
+				cs.area_w = tree_sum(&w[0], n);
+				cs.area_lx = tree_sum(&lx[0], n);
+				cs.area_wx = tree_sum(&wx[0], n);
+			}
+	}
+
+private:
+	int Size;
+	int ChunkRows;
+	int NR;
+	int Cols;
+	int Rows;
+	int NChunks;
+	std::vector<RowStats> Chunks;
+};
+
+// totals of a histogram bin of difference pixels new in mask (in) and new
+// out of mask (out)
+struct HistogramStats
+{
+	size_t cnt_in;
+	size_t cnt_out;
+	double area_in;
+	double area_out;
+};
+
+// Histogram of the distance of the difference pixels to the nearest pixel
+// of the other class in the reference in real world units, the distance in
+// pixels times pixel size divided by the scale factor.  A difference pixel
+// is normal for a radius if this is less than the radius so the counts and
+// areas of normal and isolated pixels for any radius follow from the bins
+// below and above it.  The bins are logarithmic with BinsPerOctave bins per
+// factor of two above 1, the first bin has the distances below 1.  Like in
+// TileStats the bins are collected per chunk of rows and added up in a
+// fixed order in the end.
+class DistanceHistogram
+{
+public:
+	enum { BinsPerOctave = 8, Octaves = 26, Bins = BinsPerOctave*Octaves+1 };
+
+	struct Bin
+	{
+		size_t cnt_in;
+		size_t cnt_out;
+		KahanSum area_in;
+		KahanSum area_out;
+	};
+
+	DistanceHistogram(int height, int chunk_rows): ChunkRows(chunk_rows)
+	{
+		NChunks = (height+chunk_rows-1)/chunk_rows;
+		Chunks.resize(size_t(NChunks)*Bins);
+		std::memset(&Chunks[0], 0, sizeof(Bin)*Chunks.size());
+	}
+
+	// bins of the chunk containing row y
+	Bin *chunk(int y) { return &Chunks[size_t(y/ChunkRows)*Bins]; }
+
+	static int bin(double dist)
+	{
+		if (!(dist >= 1.0))
+			return 0;
+		return std::min<int>(Bins-1, 1 + int(std::floor(BinsPerOctave*std::log2(dist))));
+	}
+
+	// lower limit of bin b, the upper one is that of b+1 (infinite for the last)
+	static double lower(int b) { return (b == 0) ? 0.0 : std::exp2(double(b-1)/BinsPerOctave); }
+
+	static void add(Bin *bins, double dist, bool in, double area)
+	{
+		Bin &b = bins[bin(dist)];
+		if (in)
+		{
+			b.cnt_in++;
+			b.area_in.add(area);
+		}
+		else
+		{
+			b.cnt_out++;
+			b.area_out.add(area);
+		}
+	}
+
+	// add the difference pixels of a row of bit masks (rows of 64 bit words
+	// as in BitMask) with the squared distances dist2 in pixels, factor
+	// converts them to real world units and area is the pixel area
+	static void add_row(Bin *bins, const unsigned long long *ref, const unsigned long long *cand, const unsigned int *dist2,
+	                    int n, double factor, double area)
+	{
+		for (int i = 0; i < (n+63)/64; i++)
+		{
+			unsigned long long diff = ref[i] ^ cand[i];
+			while (diff)
+			{
+				int b = __builtin_ctzll(diff);
+				diff &= diff-1;
+				add(bins, std::sqrt(double(dist2[i*64+b]))*factor, (cand[i] >> b) & 1, area);
+			}
+		}
+	}
+
+	// totals of the Bins bins
+	void merge(HistogramStats *bins) const
+	{
+		std::vector<double> in(NChunks), out(NChunks);
+
+		for (int k = 0; k < Bins; k++)
+		{
+			HistogramStats &hs = bins[k];
+			std::memset(&hs, 0, sizeof(hs));
+			for (int c = 0; c < NChunks; c++)
+			{
+				const Bin &b = Chunks[size_t(c)*Bins+k];
+				hs.cnt_in += b.cnt_in;
+				hs.cnt_out += b.cnt_out;
+				in[c] = b.area_in.sum;
+				out[c] = b.area_out.sum;
+			}
+			hs.area_in = tree_sum(&in[0], NChunks);
+			hs.area_out = tree_sum(&out[0], NChunks);
+		}
+	}
+
+private:
+	int ChunkRows;
+	int NChunks;
+	std::vector<Bin> Chunks;
+};
+
+// Structured results of a comparison written as JSON (-json <file>) and/or
+// CSV (-csv <file>): the totals for every file and radius and the tiles of
+// -T <size> pixels with differences, with their counts and weighted area.
+// The tiles are located by their column and row in the tile grid, the JSON
+// also has the geotransform of the images to map them to coordinates.
+// With -hotspot <file> the weighted areas of all tiles are written as a
+// GeoTIFF with one pixel per tile and one band per file and radius, with
+// -hist <file> the distance histograms (see DistanceHistogram) of the files
+// as CSV.
+class CompareReport
+{
+public:
+	CompareReport(): TileSize(1024), FileJSON(NULL), FileCSV(NULL), FileHotspot(NULL), FileHist(NULL), Width(0), Height(0), AreaAll(0.0)
+	{
+		std::memset(GeoTransform, 0, sizeof(GeoTransform));
+	}
+
+	// Parse a report option at argv[i], i is advanced past its value.
+	// Returns false if argv[i] is not a report option.
+	bool option(int argc, char **argv, int &i)
+	{
+		if (i+1 >= argc)
+			return false;
+		if (std::strcmp(argv[i], "-json") == 0)
+			FileJSON = argv[++i];
+		else if (std::strcmp(argv[i], "-csv") == 0)
+			FileCSV = argv[++i];
+		else if (std::strcmp(argv[i], "-hotspot") == 0)
+			FileHotspot = argv[++i];
+		else if (std::strcmp(argv[i], "-hist") == 0)
+			FileHist = argv[++i];
+		else if (std::strcmp(argv[i], "-T") == 0)
+			TileSize = std::max(1, std::atoi(argv[++i]));
+		else
+			return false;
+		return true;
+	}
+
+	static void usage()
+	{
+		std::fprintf(stderr,"    -json <file>    write results with the differences per tile as JSON\n");
+		std::fprintf(stderr,"    -csv <file>     write results with the differences per tile as CSV\n");
+		std::fprintf(stderr,"    -hotspot <file> write the weighted difference area per tile as GeoTIFF\n");
+		std::fprintf(stderr,"    -T <size>       tile size of the report in pixels (default: 1024)\n");
+		std::fprintf(stderr,"    -hist <file>    write the histogram of difference pixel distances as CSV\n");
+	}
+
+	// true if differences per tile are needed
+	bool enabled() const { return FileJSON || FileCSV || FileHotspot; }
+
+	// true if the distance histograms are needed
+	bool histogram() const { return FileHist; }
+
+	// Set up the report for images of width x height pixels with the given
+	// georeferencing (projection as WKT), the tile size is rounded up to a
+	// multiple of the chunk_rows of the comparison (see TileStats).
+	void setup(const char *tool, const char *reference, int width, int height, const double *geotransform, const char *projection, int chunk_rows)
+	{
+		Tool = tool;
+		Reference = reference;
+		Projection = projection ? projection : "";
+		Width = width;
+		Height = height;
+		std::memcpy(GeoTransform, geotransform, sizeof(GeoTransform));
+		TileSize = chunk_rows*((TileSize+chunk_rows-1)/chunk_rows);
+	}
+
+	int tile_size() const { return TileSize; }
+
+	// number of tiles
+	size_t tiles() const { return size_t(cols())*rows(); }
+
+	// total area of the reference the ratings are relative to
+	void set_area(double area_all) { AreaAll = area_all; }
+
+	void set_weights(const CompareWeights &weights) { Weights = weights; }
+
+	// results of a file and radius, tiles as from TileStats::merge()
+	void add(const char *fnm, float radius, const CompareStats &total, const CompareStats *tiles)
+	{
+		Entry e;
+		e.File = fnm;
+		e.Radius = radius;
+		e.Total = total;
+		e.Tiles.assign(tiles, tiles + this->tiles());
+		Entries.push_back(e);
+	}
+
+	// distance histogram of a file, bins as from DistanceHistogram::merge()
+	void add_histogram(const char *fnm, const HistogramStats *bins)
+	{
+		Histogram h;
+		h.File = fnm;
+		h.Bins.assign(bins, bins + DistanceHistogram::Bins);
+		Histograms.push_back(h);
+	}
+
+	// write the requested files, returns false on failure
+	bool write() const
+	{
+		if (FileJSON && !write_file(FileJSON, false))
+			return false;
+		if (FileCSV && !write_file(FileCSV, true))
+			return false;
+		if (FileHotspot && !write_hotspot(FileHotspot))
+			return false;
+		if (FileHist && !write_file(FileHist, true, true))
+			return false;
+		return true;
+	}
+
+private:
+	struct Entry
+	{
+		std::string File;
+		float Radius;
+		CompareStats Total;
+		std::vector<CompareStats> Tiles;
+	};
+
+	struct Histogram
+	{
+		std::string File;
+		std::vector<HistogramStats> Bins;
+	};
+
+	int TileSize;
+	const char *FileJSON;
+	const char *FileCSV;
+	const char *FileHotspot;
+	const char *FileHist;
+
+	std::string Tool;
+	std::string Reference;
+	std::string Projection;
+	int Width;
+	int Height;
+	double GeoTransform[6];
+	double AreaAll;
+	CompareWeights Weights;
+	std::vector<Entry> Entries;
+	std::vector<Histogram> Histograms;
+
+	int cols() const { return (Width+TileSize-1)/TileSize; }
+	int rows() const { return (Height+TileSize-1)/TileSize; }
+
+	static bool empty(const CompareStats &cs)
+	{
+		return (cs.cnt_l | cs.cnt_w | cs.cnt_lx | cs.cnt_wx) == 0;
+	}
+
+	// strings are quoted in both formats, in CSV quotes are doubled and
+	// everything else is kept, in JSON control characters are escaped too
+	static std::string escape(const std::string &s, bool csv)
+	{
+		std::string r;
+		for (size_t i = 0; i < s.size(); i++)
+		{
+			unsigned char c = s[i];
+			if (c == '"')
+				r += csv ? '"' : '\\';
+			else if (!csv && (c == '\\'))
+				r += '\\';
+			else if (!csv && (c < 0x20))
+			{
+				char u[8];
+				std::snprintf(u, sizeof(u), "\\u%04x", c);
+				r += u;
+				continue;
+			}
+			r += c;
+		}
+		return r;
+	}
+
+	// the rating as a JSON number or CSV field, null or an empty field if
+	// the reference has no area
+	std::string rating(double area_weighted, bool csv) const
+	{
+		if (!(AreaAll > 0.0))
+			return csv ? "" : "null";
+		char r[32];
+		std::snprintf(r, sizeof(r), "%.9f", area_weighted/AreaAll);
+		return r;
+	}
+
+	void write_json(FILE *f) const
+	{
+		std::fprintf(f, "{\n  \"tool\": \"%s\",\n  \"reference\": \"%s\",\n", escape(Tool, false).c_str(), escape(Reference, false).c_str());
+		std::fprintf(f, "  \"width\": %d, \"height\": %d,\n", Width, Height);
+		std::fprintf(f, "  \"geotransform\": [ %.17g, %.17g, %.17g, %.17g, %.17g, %.17g ],\n",
+		             GeoTransform[0], GeoTransform[1], GeoTransform[2], GeoTransform[3], GeoTransform[4], GeoTransform[5]);
+		std::fprintf(f, "  \"area_all\": %.6f,\n", AreaAll);
+		std::fprintf(f, "  \"weights\": { \"l\": %g, \"lx\": %g, \"w\": %g, \"wx\": %g },\n", Weights.l, Weights.lx, Weights.w, Weights.wx);
+		std::fprintf(f, "  \"tile_size\": %d, \"tile_cols\": %d, \"tile_rows\": %d,\n", TileSize, cols(), rows());
+		std::fprintf(f, "  \"results\": [\n");
+
+		for (size_t k = 0; k < Entries.size(); k++)
+		{
+			const Entry &e = Entries[k];
+			const CompareStats &cs = e.Total;
+			double area_weighted = weighted_area(cs, Weights);
+
+			std::fprintf(f, "    {\n      \"file\": \"%s\", \"radius\": %g,\n", escape(e.File, false).c_str(), e.Radius);
+			std::fprintf(f, "      \"cnt_l\": %zu, \"area_l\": %.6f, \"cnt_lx\": %zu, \"area_lx\": %.6f,\n", cs.cnt_l, cs.area_l, cs.cnt_lx, cs.area_lx);
+			std::fprintf(f, "      \"cnt_w\": %zu, \"area_w\": %.6f, \"cnt_wx\": %zu, \"area_wx\": %.6f,\n", cs.cnt_w, cs.area_w, cs.cnt_wx, cs.area_wx);
+			std::fprintf(f, "      \"area_weighted\": %.6f, \"rating\": %s,\n", area_weighted, rating(area_weighted, false).c_str());
+			std::fprintf(f, "      \"tiles\": [");
+
+			bool first = true;
+			for (int ty = 0; ty < rows(); ty++)
+				for (int tx = 0; tx < cols(); tx++)
+				{
+					const CompareStats &ts = e.Tiles[size_t(ty)*cols()+tx];
+					if (empty(ts))
+						continue;
+					std::fprintf(f, "%s\n        { \"col\": %d, \"row\": %d, \"cnt_l\": %zu, \"cnt_lx\": %zu, \"cnt_w\": %zu, \"cnt_wx\": %zu, \"area_weighted\": %.6f }",
+					             first ? "" : ",", tx, ty, ts.cnt_l, ts.cnt_lx, ts.cnt_w, ts.cnt_wx, weighted_area(ts, Weights));
+					first = false;
+				}
+
+			std::fprintf(f, "%s]\n    }%s\n", first ? " " : "\n      ", (k+1 < Entries.size()) ? "," : "");
+		}
+
+		std::fprintf(f, "  ]\n}\n");
+	}
+
+	// one line per file and radius with the totals and one per tile with
+	// differences, the tile columns are empty for the totals
+	void write_csv(FILE *f) const
+	{
+		std::fprintf(f, "file,radius,tile_col,tile_row,cnt_l,area_l,cnt_lx,area_lx,cnt_w,area_w,cnt_wx,area_wx,area_weighted,rating\n");
+
+		for (size_t k = 0; k < Entries.size(); k++)
+		{
+			const Entry &e = Entries[k];
+			std::string fnm = escape(e.File, true);
+
+			for (int t = -1; t < cols()*rows(); t++)
+			{
+				const CompareStats &cs = (t < 0) ? e.Total : e.Tiles[t];
+				if ((t >= 0) && empty(cs))
+					continue;
+
+				double area_weighted = weighted_area(cs, Weights);
+				std::fprintf(f, "\"%s\",%g,", fnm.c_str(), e.Radius);
+				if (t < 0)
+					std::fprintf(f, ",,");
+				else
+					std::fprintf(f, "%d,%d,", t % cols(), t / cols());
+				std::fprintf(f, "%zu,%.6f,%zu,%.6f,%zu,%.6f,%zu,%.6f,%.6f,", cs.cnt_l, cs.area_l, cs.cnt_lx, cs.area_lx,
+				             cs.cnt_w, cs.area_w, cs.cnt_wx, cs.area_wx, area_weighted);
+				std::fprintf(f, "%s\n", (t < 0) ? rating(area_weighted, true).c_str() : "");
+			}
+		}
+	}
+
+	// one line per file and bin with differences, the distances in the
+	// units of the radius
+	void write_histogram(FILE *f) const
+	{
+		std::fprintf(f, "file,min_distance,max_distance,cnt_in,area_in,cnt_out,area_out\n");
+
+		for (size_t k = 0; k < Histograms.size(); k++)
+		{
+			const Histogram &h = Histograms[k];
+			std::string fnm = escape(h.File, true);
+
+			for (int b = 0; b < DistanceHistogram::Bins; b++)
+			{
+				const HistogramStats &hs = h.Bins[b];
+				if ((hs.cnt_in | hs.cnt_out) == 0)
+					continue;
+
+				std::fprintf(f, "\"%s\",%.6g,", fnm.c_str(), DistanceHistogram::lower(b));
+				if (b+1 < DistanceHistogram::Bins)
+					std::fprintf(f, "%.6g,", DistanceHistogram::lower(b+1));
+				else
+					std::fprintf(f, "inf,");
+				std::fprintf(f, "%zu,%.6f,%zu,%.6f\n", hs.cnt_in, hs.area_in, hs.cnt_out, hs.area_out);
+			}
+		}
+	}
+
+	bool write_file(const char *fnm, bool csv, bool histogram = false) const
+	{
+		FILE *f = std::fopen(fnm, "w");
+		if (f == NULL)
+		{
+			std::fprintf(stderr,"  writing report %s failed.\n", fnm);
+			return false;
+		}
+
+		if (histogram)
+			write_histogram(f);
+		else if (csv)
+			write_csv(f);
+		else
+			write_json(f);
+
+		bool ok = !std::ferror(f);
+		if ((std::fclose(f) != 0) || !ok)
+		{
+			std::fprintf(stderr,"  writing report %s failed.\n", fnm);
+			return false;
+		}
+		return true;
+	}
+
+	// the pixels are the tiles so the geotransform is scaled by the tile
+	// size, the last column and row extend beyond the image if it is not a
+	// multiple of the tile size
+	bool write_hotspot(const char *fnm) const
+	{
+		GDALDriver *poDriver = GetGDALDriverManager()->GetDriverByName("GTiff");
+		GDALDataset *poDataset = NULL;
+		if (poDriver)
+			poDataset = poDriver->Create(fnm, cols(), rows(), Entries.size(), GDT_Float32, NULL);
+		if (poDataset == NULL)
+		{
+			std::fprintf(stderr,"  creating hotspot file %s failed.\n", fnm);
+			return false;
+		}
+
+		double gt[6] = { GeoTransform[0], GeoTransform[1]*TileSize, GeoTransform[2]*TileSize,
+		                 GeoTransform[3], GeoTransform[4]*TileSize, GeoTransform[5]*TileSize };
+		poDataset->SetGeoTransform(gt);
+		if (!Projection.empty())
+			poDataset->SetProjection(Projection.c_str());
+
+		bool ok = true;
+		std::vector<float> area(tiles());
+		for (size_t k = 0; (k < Entries.size()) && ok; k++)
+		{
+			const Entry &e = Entries[k];
+			for (size_t t = 0; t < area.size(); t++)
+				area[t] = weighted_area(e.Tiles[t], Weights);
+
+			char desc[64];
+			std::snprintf(desc, sizeof(desc), ", radius %g", e.Radius);
+
+			GDALRasterBand *poBand = poDataset->GetRasterBand(k+1);
+			poBand->SetDescription((e.File + desc).c_str());
+			ok = (poBand->RasterIO( GF_Write, 0, 0, cols(), rows(), &area[0], cols(), rows(), GDT_Float32, 0, 0 ) == CE_None);
+		}
+
+		GDALClose(poDataset);
+
+		if (!ok)
+			std::fprintf(stderr,"  writing hotspot file %s failed.\n", fnm);
+		return ok;
+	}
+};
+
+#endif
@@ -0,0 +1,340 @@
+/* ========================================================================
+    File: @(#)gdal_output.h
+   ------------------------------------------------------------------------
+    output datasets of the gdal-tools
+    Copyright (C) 2014-2015 Christoph Hormann <chris_hormann@gmx.de>
+   ------------------------------------------------------------------------
+
+    This file is part of gdal-tools
+
+    gdal-tools is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gdal-tools is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gdal-tools.  If not, see <http://www.gnu.org/licenses/>.
+
+   ========================================================================
+ */
+
+#ifndef GDAL_OUTPUT_H
+#define GDAL_OUTPUT_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+
+#include <gdal_priv.h>
+
+#include "gdal_iothread.h"
+
+// Destination of the results of a tool.  Without an output file name the
+// input is modified in place.  Otherwise the input is opened read only and
+// a new dataset of the same size, bands, data type and georeferencing is
+// created with the given driver and creation options (-o, -of, -co like in
+// gdal_translate).  The bands need to have the same data type then, nodata
+// values, color interpretation and mask bands are copied.  Drivers that can
+// only copy datasets (like COG) get a temporary GeoTIFF next to the output
+// which is converted when closing.
+//
+// Processed strips are written by write jobs.  For a new dataset the jobs
+// run in an IOThread so writing overlaps with processing the next strip, in
+// place they run immediately so the input can be read in the background
+// instead.
+class OutputDataset
+{
+public:
+	OutputDataset():
+		Driver("GTiff"), Options(NULL), Input(NULL), Output(NULL), Source(NULL), Writer(NULL)
+	{
+	}
+
+	~OutputDataset()
+	{
+		CSLDestroy(Options);
+	}
+
+	// Parse an output option at argv[i], i is advanced past its value.
+	// Returns false if argv[i] is not an output option.
+	bool option(int argc, char **argv, int &i)
+	{
+		if (i+1 >= argc)
+			return false;
+		if (std::strcmp(argv[i], "-o") == 0)
+			File = argv[++i];
+		else if (std::strcmp(argv[i], "-of") == 0)
+			Driver = argv[++i];
+		else if (std::strcmp(argv[i], "-co") == 0)
+			Options = CSLAddString(Options, argv[++i]);
+		else
+			return false;
+		return true;
+	}
+
+	static void usage()
+	{
+		std::fprintf(stderr,"    -o <file>       write to a new file instead of modifying the input\n");
+		std::fprintf(stderr,"    -of <format>    driver of the output file (default: GTiff)\n");
+		std::fprintf(stderr,"    -co <NAME=VAL>  creation option of the output file, can be repeated\n");
+	}
+
+	bool in_place() const { return File.empty(); }
+
+	// Open the input and create the output, exits on failure.
+	GDALDataset *open(const char *fnm)
+	{
+		Input = (GDALDataset *) GDALOpen( fnm, in_place() ? GA_Update : GA_ReadOnly );
+		if( Input == NULL )
+		{
+			std::fprintf(stderr,"  opening file %s failed.\n\n", fnm);
+			std::exit(1);
+		}
+
+		if (in_place())
+		{
+			Output = Input;
+			return Input;
+		}
+
+		// the drivers create all bands with the same data type
+		GDALDataType eType = Input->GetRasterBand(1)->GetRasterDataType();
+		for (int i = 2; i <= Input->GetRasterCount(); i++)
+			if (Input->GetRasterBand(i)->GetRasterDataType() != eType)
+			{
+				std::fprintf(stderr,"  bands of different data types can only be modified in place.\n\n");
+				std::exit(1);
+			}
+
+		GDALDriver *poDriver = GetGDALDriverManager()->GetDriverByName(Driver.c_str());
+		if (poDriver == NULL)
+		{
+			std::fprintf(stderr,"  unknown output format %s.\n\n", Driver.c_str());
+			std::exit(1);
+		}
+
+		const char *create = poDriver->GetMetadataItem(GDAL_DCAP_CREATE);
+		const char *copy = poDriver->GetMetadataItem(GDAL_DCAP_CREATECOPY);
+
+		if (create && CPLTestBool(create))
+			Output = poDriver->Create(File.c_str(), Input->GetRasterXSize(), Input->GetRasterYSize(), Input->GetRasterCount(),
+			                          eType, Options);
+		else if (copy && CPLTestBool(copy))
+		{
+			GDALDriver *poTmpDriver = GetGDALDriverManager()->GetDriverByName("GTiff");
+			char **tmp_options = NULL;
+			tmp_options = CSLAddString(tmp_options, "TILED=YES");
+			tmp_options = CSLAddString(tmp_options, "BIGTIFF=IF_SAFER");
+			Temp = File + ".tmp.tif";
+			if (poTmpDriver)
+				Output = poTmpDriver->Create(Temp.c_str(), Input->GetRasterXSize(), Input->GetRasterYSize(), Input->GetRasterCount(),
+				                             eType, tmp_options);
+			CSLDestroy(tmp_options);
+		}
+		else
+		{
+			std::fprintf(stderr,"  output format %s cannot create files.\n\n", Driver.c_str());
+			std::exit(1);
+		}
+
+		if (Output == NULL)
+		{
+			std::fprintf(stderr,"  creating file %s failed.\n\n", File.c_str());
+			std::exit(1);
+		}
+
+		double adfGeoTransform[6];
+		if (Input->GetGeoTransform(adfGeoTransform) == CE_None)
+			Output->SetGeoTransform(adfGeoTransform);
+		if (Input->GetProjectionRef() != NULL)
+			Output->SetProjection(Input->GetProjectionRef());
+
+		for (int i = 1; i <= Input->GetRasterCount(); i++)
+		{
+			int has_nodata = FALSE;
+			double nodata = Input->GetRasterBand(i)->GetNoDataValue(&has_nodata);
+			if (has_nodata)
+				Output->GetRasterBand(i)->SetNoDataValue(nodata);
+			// alpha bands are masks as well
+			Output->GetRasterBand(i)->SetColorInterpretation(Input->GetRasterBand(i)->GetColorInterpretation());
+		}
+
+		copy_masks();
+
+		std::fprintf(stderr,"  writing to %s (%s)\n", File.c_str(), Driver.c_str());
+
+		Writer = new IOThread();
+
+		return Input;
+	}
+
+	// dataset and bands the results are written to
+	GDALDataset *dataset() { return Output; }
+	GDALRasterBand *band(int n) { return Output->GetRasterBand(n); }
+
+	// Band to read the original data from in write jobs, the input itself
+	// in place and a separate handle of the input otherwise so the main
+	// thread can read the input at the same time.
+	GDALRasterBand *source_band(int n)
+	{
+		if (in_place())
+			return Input->GetRasterBand(n);
+
+		if (Source == NULL)
+		{
+			Source = (GDALDataset *) GDALOpen( Input->GetDescription(), GA_ReadOnly );
+			if( Source == NULL )
+			{
+				std::fprintf(stderr,"  opening file %s failed.\n\n", Input->GetDescription());
+				std::exit(1);
+			}
+		}
+		return Source->GetRasterBand(n);
+	}
+
+	// Run a job writing a strip of results, it returns false on failure.
+	// Waits for the previous job to finish first, so the data of a job is
+	// needed until the next call of write(), flush() or close() and two
+	// buffers used alternately are sufficient.  Exits if writing failed.
+	void write(std::function<bool()> job)
+	{
+		if (in_place())
+		{
+			if (!job())
+				fail();
+			return;
+		}
+
+		if (!Writer->start(job))
+			fail();
+	}
+
+	// Wait for the last job to finish, exits if writing failed.
+	void flush()
+	{
+		if (!in_place() && !Writer->wait())
+			fail();
+	}
+
+	// Finish writing and close input and output, with a temporary file it
+	// is converted to the output format now.  Exits on failure.
+	void close()
+	{
+		if (!in_place())
+		{
+			flush();
+			delete Writer;
+			Writer = NULL;
+
+			if (Source)
+				GDALClose(Source);
+
+			if (!Temp.empty())
+			{
+				std::fprintf(stderr,"  converting to %s...\n", Driver.c_str());
+
+				GDALDriver *poDriver = GetGDALDriverManager()->GetDriverByName(Driver.c_str());
+				GDALDataset *poCopy = poDriver->CreateCopy(File.c_str(), Output, FALSE, Options, NULL, NULL);
+				if (poCopy == NULL)
+				{
+					std::fprintf(stderr,"  creating file %s failed.\n\n", File.c_str());
+					std::exit(1);
+				}
+				GDALClose(poCopy);
+
+				GDALDriver *poTmpDriver = Output->GetDriver();
+				GDALClose(Output);
+				poTmpDriver->Delete(Temp.c_str());
+			}
+			else
+				GDALClose(Output);
+		}
+
+		GDALClose(Input);
+		Input = Output = Source = NULL;
+	}
+
+private:
+	std::string File;
+	std::string Driver;
+	char **Options;
+	std::string Temp;
+
+	GDALDataset *Input;
+	GDALDataset *Output;
+	GDALDataset *Source;
+
+	IOThread *Writer;
+
+	static void fail()
+	{
+		std::fprintf(stderr,"  writing data failed.\n\n");
+		std::exit(1);
+	}
+
+	// Copy the mask bands of the input not given by nodata values or an
+	// alpha band (like a .msk file), the tools do not change which pixels
+	// are valid so they are copied right away.  A per dataset mask is
+	// created once for all bands.  Exits on failure.
+	void copy_masks()
+	{
+		bool dataset_mask = false;
+		for (int i = 1; i <= Input->GetRasterCount(); i++)
+		{
+			GDALRasterBand *poBand = Input->GetRasterBand(i);
+			int flags = poBand->GetMaskFlags();
+			if (flags & (GMF_ALL_VALID | GMF_NODATA | GMF_ALPHA))
+				continue;
+
+			if (flags & GMF_PER_DATASET)
+			{
+				if (dataset_mask)
+					continue;
+				dataset_mask = true;
+			}
+
+			std::fprintf(stderr,"  copying mask of band %d...\n", i);
+
+			CPLErr err;
+			if (flags & GMF_PER_DATASET)
+				err = Output->CreateMaskBand(GMF_PER_DATASET);
+			else
+				err = Output->GetRasterBand(i)->CreateMaskBand(0);
+
+			if ((err != CE_None) || !copy_band(poBand->GetMaskBand(), Output->GetRasterBand(i)->GetMaskBand()))
+			{
+				std::fprintf(stderr,"  creating mask of band %d failed.\n\n", i);
+				std::exit(1);
+			}
+		}
+	}
+
+	// copy a Byte band in strips of at most 16 MB
+	bool copy_band(GDALRasterBand *poSrc, GDALRasterBand *poDst)
+	{
+		int nXSize = Input->GetRasterXSize();
+		int nYSize = Input->GetRasterYSize();
+		int nRows = std::max(1, std::min(nYSize, (1 << 24)/std::max(1, nXSize)));
+		std::vector<unsigned char> strip(size_t(nXSize)*nRows);
+
+		for (int y0 = 0; y0 < nYSize; y0 += nRows)
+		{
+			int n = std::min(nRows, nYSize-y0);
+			if ((poSrc->RasterIO( GF_Read, 0, y0, nXSize, n, &strip[0], nXSize, n, GDT_Byte, 0, 0 ) != CE_None) ||
+			    (poDst->RasterIO( GF_Write, 0, y0, nXSize, n, &strip[0], nXSize, n, GDT_Byte, 0, 0 ) != CE_None))
+				return false;
+		}
+		return true;
+	}
+};
+
+#endif
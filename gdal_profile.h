@@ -0,0 +1,270 @@
+/* ========================================================================
+    File: @(#)gdal_profile.h
+   ------------------------------------------------------------------------
+    per phase timing and counters of the gdal-tools
+    Copyright (C) 2014-2015 Christoph Hormann <chris_hormann@gmx.de>
+   ------------------------------------------------------------------------
+
+    This file is part of gdal-tools
+
+    gdal-tools is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gdal-tools is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gdal-tools.  If not, see <http://www.gnu.org/licenses/>.
+
+   ========================================================================
+ */
+
+#ifndef GDAL_PROFILE_H
+#define GDAL_PROFILE_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+#include <sys/resource.h>
+
+#include "gdal_scalefactors.h"
+
+// Profile of a tool run split into the phases announced by the progress
+// lines, enabled by setting GDAL_TOOLS_PROFILE to a file name.  For every
+// phase wall and CPU time (of all threads), bytes read and written with
+// GDAL, projection scale factor evaluations, pixels processed and the peak
+// memory of the process at its end are recorded.  The profile is written
+// when the program exits, in Prometheus text format if the file name ends
+// in .prom and as JSON otherwise.
+//
+// The counters can be updated from any thread, work done in the background
+// (like reading ahead) counts for the phase running at that time.
+class PhaseProfile
+{
+public:
+	PhaseProfile(): Enabled(false), BytesRead(0), BytesWritten(0), Pixels(0)
+	{
+		const char *fnm = std::getenv("GDAL_TOOLS_PROFILE");
+		if (fnm && fnm[0])
+		{
+			File = fnm;
+			Enabled = true;
+		}
+	}
+
+	~PhaseProfile()
+	{
+		if (!Enabled || Tool.empty())
+			return;
+
+		end_phase();
+		write();
+	}
+
+	bool enabled() const { return Enabled; }
+
+	// start profiling a tool with the first phase
+	void begin(const char *tool)
+	{
+		Tool = tool;
+		std::string::size_type p = Tool.find(' ');
+		Name = Tool.substr(0, p);
+		T0 = std::chrono::steady_clock::now();
+		if (Enabled)
+			start_phase("startup");
+	}
+
+	// end the current phase and start the next one
+	void phase(const char *name)
+	{
+		if (!Enabled || Tool.empty())
+			return;
+		end_phase();
+		start_phase(name);
+	}
+
+	void read(size_t bytes) { if (Enabled) BytesRead += bytes; }
+	void written(size_t bytes) { if (Enabled) BytesWritten += bytes; }
+	void pixels(size_t n) { if (Enabled) Pixels += n; }
+
+private:
+	struct Counters
+	{
+		double Wall;
+		double Cpu;
+		size_t BytesRead;
+		size_t BytesWritten;
+		size_t Evaluations;
+		size_t Pixels;
+		long PeakKB;
+	};
+
+	struct Phase
+	{
+		std::string Name;
+		Counters Values;
+	};
+
+	bool Enabled;
+	std::string File;
+	std::string Tool;
+	std::string Name;
+
+	std::atomic<size_t> BytesRead;
+	std::atomic<size_t> BytesWritten;
+	std::atomic<size_t> Pixels;
+
+	std::chrono::steady_clock::time_point T0;
+	Counters Start;
+	std::string Current;
+	std::vector<Phase> Phases;
+
+	Counters now()
+	{
+		struct rusage ru;
+		getrusage(RUSAGE_SELF, &ru);
+
+		Counters c;
+		c.Wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - T0).count();
+		c.Cpu = ru.ru_utime.tv_sec + 1.0e-6*ru.ru_utime.tv_usec + ru.ru_stime.tv_sec + 1.0e-6*ru.ru_stime.tv_usec;
+		c.BytesRead = BytesRead;
+		c.BytesWritten = BytesWritten;
+		c.Evaluations = ScaleFactorGrid::total_evaluations();
+		c.Pixels = Pixels;
+		c.PeakKB = ru.ru_maxrss;
+		return c;
+	}
+
+	void start_phase(const char *name)
+	{
+		Start = now();
+		Current = name;
+	}
+
+	void end_phase()
+	{
+		Counters c = now();
+		Phase p;
+		p.Name = Current;
+		p.Values.Wall = c.Wall - Start.Wall;
+		p.Values.Cpu = c.Cpu - Start.Cpu;
+		p.Values.BytesRead = c.BytesRead - Start.BytesRead;
+		p.Values.BytesWritten = c.BytesWritten - Start.BytesWritten;
+		p.Values.Evaluations = c.Evaluations - Start.Evaluations;
+		p.Values.Pixels = c.Pixels - Start.Pixels;
+		p.Values.PeakKB = c.PeakKB;
+		Phases.push_back(p);
+	}
+
+	Counters total() const
+	{
+		Counters t = { 0.0, 0.0, 0, 0, 0, 0, 0 };
+		for (size_t i = 0; i < Phases.size(); i++)
+		{
+			const Counters &c = Phases[i].Values;
+			t.Wall += c.Wall;
+			t.Cpu += c.Cpu;
+			t.BytesRead += c.BytesRead;
+			t.BytesWritten += c.BytesWritten;
+			t.Evaluations += c.Evaluations;
+			t.Pixels += c.Pixels;
+			t.PeakKB = std::max(t.PeakKB, c.PeakKB);
+		}
+		return t;
+	}
+
+	static std::string escape(const std::string &s)
+	{
+		std::string r;
+		for (size_t i = 0; i < s.size(); i++)
+		{
+			if ((s[i] == '"') || (s[i] == '\\'))
+				r += '\\';
+			r += s[i];
+		}
+		return r;
+	}
+
+	static void write_json(FILE *f, const Counters &c)
+	{
+		std::fprintf(f, "\"wall_seconds\": %.6f, \"cpu_seconds\": %.6f, \"bytes_read\": %zu, \"bytes_written\": %zu, "
+		             "\"projection_calls\": %zu, \"pixels\": %zu, \"peak_memory_bytes\": %zu",
+		             c.Wall, c.Cpu, c.BytesRead, c.BytesWritten, c.Evaluations, c.Pixels, size_t(c.PeakKB)*1024);
+	}
+
+	void write_prometheus(FILE *f)
+	{
+		static const char *Metrics[][2] =
+		{
+			{ "wall_seconds", "Wall clock time of the phase" },
+			{ "cpu_seconds", "CPU time of all threads in the phase" },
+			{ "bytes_read", "Bytes read from raster files in the phase" },
+			{ "bytes_written", "Bytes written to raster files in the phase" },
+			{ "projection_calls", "Projection scale factor evaluations in the phase" },
+			{ "pixels", "Pixels processed in the phase" },
+			{ "peak_memory_bytes", "Peak resident memory of the process at the end of the phase" },
+		};
+
+		for (int m = 0; m < 7; m++)
+		{
+			std::fprintf(f, "# HELP gdal_tools_phase_%s %s\n", Metrics[m][0], Metrics[m][1]);
+			std::fprintf(f, "# TYPE gdal_tools_phase_%s gauge\n", Metrics[m][0]);
+			for (size_t i = 0; i <= Phases.size(); i++)
+			{
+				Counters c = (i < Phases.size()) ? Phases[i].Values : total();
+				std::string phase = (i < Phases.size()) ? escape(Phases[i].Name) : "total";
+				double v[7] = { c.Wall, c.Cpu, double(c.BytesRead), double(c.BytesWritten), double(c.Evaluations),
+				                double(c.Pixels), double(c.PeakKB)*1024.0 };
+				std::fprintf(f, "gdal_tools_phase_%s{tool=\"%s\",phase=\"%s\"} %.17g\n",
+				             Metrics[m][0], escape(Name).c_str(), phase.c_str(), v[m]);
+			}
+		}
+	}
+
+	void write()
+	{
+		FILE *f = std::fopen(File.c_str(), "w");
+		if (f == NULL)
+		{
+			std::fprintf(stderr,"  writing profile %s failed.\n", File.c_str());
+			return;
+		}
+
+		if ((File.size() > 5) && (File.compare(File.size()-5, 5, ".prom") == 0))
+			write_prometheus(f);
+		else
+		{
+			std::fprintf(f, "{\n  \"tool\": \"%s\",\n  \"phases\": [\n", escape(Tool).c_str());
+			for (size_t i = 0; i < Phases.size(); i++)
+			{
+				std::fprintf(f, "    { \"phase\": \"%s\", ", escape(Phases[i].Name).c_str());
+				write_json(f, Phases[i].Values);
+				std::fprintf(f, " }%s\n", (i+1 < Phases.size()) ? "," : "");
+			}
+			std::fprintf(f, "  ],\n  \"total\": { ");
+			write_json(f, total());
+			std::fprintf(f, " }\n}\n");
+		}
+
+		std::fclose(f);
+	}
+};
+
+// profile of the running tool
+inline PhaseProfile &profile()
+{
+	static PhaseProfile p;
+	return p;
+}
+
+#endif
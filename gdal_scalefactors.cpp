@@ -0,0 +1,778 @@
+/* ========================================================================
+    File: @(#)gdal_scalefactors.cpp
+   ------------------------------------------------------------------------
+    projection scale factor evaluation for the gdal-tools
+    Copyright (C) 2014-2015 Christoph Hormann <chris_hormann@gmx.de>
+   ------------------------------------------------------------------------
+
+    This file is part of gdal-tools
+
+    gdal-tools is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gdal-tools is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gdal-tools.  If not, see <http://www.gnu.org/licenses/>.
+
+   ========================================================================
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <map>
+#include <atomic>
+
+#include "gdal_scalefactors.h"
+
+// ---------------------------------------------------------------------------
+// backends
+
+ScaleFactors WebMercatorBackend::factors(double, double y)
+{
+	ScaleFactors f;
+	double scale = std::cosh(y/Radius);
+	f.h = scale;
+	f.k = scale;
+	f.s = scale*scale;
+	f.ok = true;
+	return f;
+}
+
+// ---------------------------------------------------------------------------
+// analytic backends
+
+// series sum x + c[0]*sin(2x) + ... + c[n-1]*sin(2nx) with Clenshaw summation
+static double lat_series(const double *c, int n, double x)
+{
+	double s2 = std::sin(2.0*x);
+	double c2 = std::cos(2.0*x);
+	double b1 = 0.0, b2 = 0.0;
+	for (int i = n-1; i >= 0; i--)
+	{
+		double b0 = c[i] + 2.0*c2*b1 - b2;
+		b2 = b1;
+		b1 = b0;
+	}
+	return x + b1*s2;
+}
+
+// coefficients of the series for the geodetic latitude from the conformal
+// latitude (Snyder, Map Projections - A Working Manual, eq. 3-5)
+static void conformal_series(double es, double *c)
+{
+	double es2 = es*es, es3 = es2*es, es4 = es3*es;
+	c[0] = es/2.0 + 5.0*es2/24.0 + es3/12.0 + 13.0*es4/360.0;
+	c[1] = 7.0*es2/48.0 + 29.0*es3/240.0 + 811.0*es4/11520.0;
+	c[2] = 7.0*es3/120.0 + 81.0*es4/1120.0;
+	c[3] = 4279.0*es4/161280.0;
+}
+
+// coefficients of the series for the geodetic latitude from the authalic
+// latitude, the same as in Proj
+static void authalic_series(double es, double *c)
+{
+	double es2 = es*es, es3 = es2*es;
+	c[0] = es/3.0 + 31.0*es2/180.0 + 517.0*es3/5040.0;
+	c[1] = 23.0*es2/360.0 + 251.0*es3/3780.0;
+	c[2] = 761.0*es3/45360.0;
+}
+
+// q of the authalic latitude like pj_qsfn()
+static double qsfn(double sinphi, double es)
+{
+	if (es < 1.0e-14)
+		return 2.0*sinphi;
+	double e = std::sqrt(es);
+	double con = e*sinphi;
+	return (1.0-es)*(sinphi/(1.0-con*con) - (0.5/e)*std::log((1.0-con)/(1.0+con)));
+}
+
+// parallel radius over a, cos(phi)/sqrt(1-es*sin^2(phi))
+static double msfn(double phi, double es)
+{
+	double s = std::sin(phi);
+	return std::cos(phi)/std::sqrt(1.0 - es*s*s);
+}
+
+static ScaleFactors conformal_factors(double k)
+{
+	ScaleFactors f;
+	f.h = k;
+	f.k = k;
+	f.s = k*k;
+	f.ok = std::isfinite(k) && (k > 0.0);
+	return f;
+}
+
+static ScaleFactors equal_area_factors(double k)
+{
+	ScaleFactors f;
+	f.h = 1.0/k;
+	f.k = k;
+	f.s = 1.0;
+	f.ok = std::isfinite(k) && (k > 0.0);
+	return f;
+}
+
+MercatorBackend::MercatorBackend(double a, double es, double k0, double y0):
+	A(a), Es(es), K0(k0), Y0(y0)
+{
+	conformal_series(es, Conformal);
+}
+
+ScaleFactors MercatorBackend::factors(double, double y)
+{
+	double yn = (y-Y0)/(A*K0);
+	if (Es == 0.0)
+		return conformal_factors(K0*std::cosh(yn));
+
+	double chi = std::atan(std::sinh(yn));
+	double phi = lat_series(Conformal, 4, chi);
+	return conformal_factors(K0/msfn(phi, Es));
+}
+
+ScaleFactors EqcBackend::factors(double, double y)
+{
+	double phi = (y-Y0)/A + Lat0;
+	// a/M and a/N with the meridional and prime vertical radii of curvature
+	double t = 1.0 - Es*std::sin(phi)*std::sin(phi);
+	ScaleFactors f;
+	f.h = t*std::sqrt(t)/(1.0-Es);
+	f.k = CosTs*std::sqrt(t)/std::cos(phi);
+	f.s = f.h*f.k;
+	f.ok = (std::abs(phi) < M_PI/2);
+	return f;
+}
+
+CeaBackend::CeaBackend(double a, double es, double k0, double y0):
+	A(a), Es(es), K0(k0), Y0(y0)
+{
+	Qp = qsfn(1.0, es);
+	authalic_series(es, Authalic);
+}
+
+ScaleFactors CeaBackend::factors(double, double y)
+{
+	double sinbeta = 2.0*K0*(y-Y0)/(A*Qp);
+	if (std::abs(sinbeta) >= 1.0)
+	{
+		ScaleFactors f = { 0.0, 0.0, 0.0, false };
+		return f;
+	}
+	double phi = lat_series(Authalic, 3, std::asin(sinbeta));
+	return equal_area_factors(K0/msfn(phi, Es));
+}
+
+ScaleFactors GeographicBackend::factors(double, double y)
+{
+	double phi = y*M_PI/180.0;
+	double s = std::sin(phi);
+	double w2 = 1.0 - Es*s*s;
+	double w = std::sqrt(w2);
+
+	// meridian and parallel radius of curvature
+	double rm = A*(1.0-Es)/(w2*w);
+	double rp = A*std::cos(phi)/w;
+
+	ScaleFactors f;
+	f.h = 180.0/(M_PI*rm);
+	f.k = 180.0/(M_PI*rp);
+	f.s = f.h*f.k;
+	f.ok = (std::abs(phi) < M_PI/2);
+	return f;
+}
+
+PolarStereBackend::PolarStereBackend(double a, double es, double lat_ts, double k0, double x0, double y0):
+	A(a), Es(es), X0(x0), Y0(y0)
+{
+	double e = std::sqrt(es);
+	double ts = std::abs(lat_ts);
+	double epole = std::sqrt(std::pow(1.0+e, 1.0+e)*std::pow(1.0-e, 1.0-e));
+
+	if (std::abs(ts - M_PI/2) < 1.0e-10)
+		Akm1 = 2.0*k0/epole;
+	else
+	{
+		double s = std::sin(ts);
+		double t = std::tan(M_PI/4 - 0.5*ts)/std::pow((1.0-e*s)/(1.0+e*s), 0.5*e);
+		Akm1 = msfn(ts, es)/t;
+	}
+
+	KPole = 0.5*Akm1*epole;
+	conformal_series(es, Conformal);
+}
+
+ScaleFactors PolarStereBackend::factors(double x, double y)
+{
+	double rho = std::sqrt((x-X0)*(x-X0) + (y-Y0)*(y-Y0))/A;
+	double t = rho/Akm1;
+
+	if (Es == 0.0)
+		return conformal_factors(0.5*Akm1*(1.0+t*t));
+	if (rho == 0.0)
+		return conformal_factors(KPole);
+
+	double phi = lat_series(Conformal, 4, M_PI/2 - 2.0*std::atan(t));
+	return conformal_factors(rho/msfn(phi, Es));
+}
+
+LaeaBackend::LaeaBackend(double a, double es, double lat_0, double x0, double y0):
+	A(a), Es(es), X0(x0), Y0(y0)
+{
+	SinLat0 = std::sin(lat_0);
+	CosLat0 = std::cos(lat_0);
+	Qp = qsfn(1.0, es);
+	authalic_series(es, Authalic);
+}
+
+ScaleFactors LaeaBackend::factors(double x, double y)
+{
+	double xn = (x-X0)/A;
+	double yn = (y-Y0)/A;
+	double rho2 = xn*xn + yn*yn;
+	double rho = std::sqrt(rho2);
+
+	ScaleFactors f = { 1.0, 1.0, 1.0, true };
+	if (rho == 0.0)
+		return f;
+
+	// ellipsoid, polar aspect only: rho^2 = qp - q
+	if (Es != 0.0)
+	{
+		double sinbeta = (Qp - rho2)/Qp;
+		if (sinbeta <= -1.0)
+		{
+			f.ok = false;
+			return f;
+		}
+		double phi = lat_series(Authalic, 3, std::asin(sinbeta));
+		return equal_area_factors(rho/msfn(phi, Es));
+	}
+
+	// sphere: the scale is cos(c/2) towards the center and 1/cos(c/2) across
+	// with the angular distance c from the center, h and k follow from the
+	// azimuth of the center seen from the point
+	if (rho >= 2.0)
+	{
+		f.ok = false;
+		return f;
+	}
+
+	double sinc = rho*std::sqrt(1.0 - 0.25*rho2);
+	double cosc = 1.0 - 0.5*rho2;
+	double sinphi = cosc*SinLat0 + yn*sinc*CosLat0/rho;
+	double cosphi = std::sqrt(std::max(0.0, 1.0 - sinphi*sinphi));
+
+	double dx = xn*sinc;
+	double dy = rho*CosLat0*cosc - yn*SinLat0*sinc;
+	double dn = std::sqrt(dx*dx + dy*dy);
+
+	double cos2 = 1.0;
+	if (dn > 0.0)
+	{
+		double n = dx/dn*CosLat0;
+		double d = cosphi*SinLat0 - sinphi*CosLat0*dy/dn;
+		if (n*n + d*d > 0.0)
+			cos2 = d*d/(n*n + d*d);
+	}
+
+	double p2 = 1.0 - 0.25*rho2;
+	double q2 = 1.0/p2;
+	f.h = std::sqrt(p2*cos2 + q2*(1.0-cos2));
+	f.k = std::sqrt(p2*(1.0-cos2) + q2*cos2);
+	return f;
+}
+
+// ---------------------------------------------------------------------------
+// backend selection
+
+// split a proj4 definition into +key=value parameters, flags without a value
+// get an empty one
+static bool parse_proj4(const char *proj4, std::map<std::string, std::string> &par)
+{
+	const char *p = proj4;
+	while (*p)
+	{
+		p += std::strspn(p, " \t");
+		if (!*p)
+			break;
+		if (*p != '+')
+			return false;
+		p++;
+		size_t n = std::strcspn(p, " \t");
+		std::string tok(p, n);
+		size_t eq = tok.find('=');
+		if (eq == std::string::npos)
+			par[tok] = "";
+		else
+			par[tok.substr(0, eq)] = tok.substr(eq+1);
+		p += n;
+	}
+	return true;
+}
+
+// numeric parameter, false if it is missing or not a plain number
+static bool num_param(const std::map<std::string, std::string> &par, const char *key, double &v)
+{
+	std::map<std::string, std::string>::const_iterator it = par.find(key);
+	if ((it == par.end()) || it->second.empty())
+		return false;
+	char *end;
+	v = std::strtod(it->second.c_str(), &end);
+	return (*end == 0);
+}
+
+struct EllipsoidDef
+{
+	const char *name;
+	double a;
+	double rf; // inverse flattening, 0 for a sphere
+};
+
+static const EllipsoidDef Ellipsoids[] =
+{
+	{ "WGS84", 6378137.0, 298.257223563 },
+	{ "GRS80", 6378137.0, 298.257222101 },
+	{ "WGS72", 6378135.0, 298.26 },
+	{ "intl", 6378388.0, 297.0 },
+	{ "bessel", 6377397.155, 299.1528128 },
+	{ "krass", 6378245.0, 298.3 },
+	{ "clrk66", 6378206.4, 6378206.4/(6378206.4-6356583.8) },
+	{ "sphere", 6370997.0, 0.0 },
+	{ NULL, 0.0, 0.0 }
+};
+
+static const char *Datums[][2] =
+{
+	{ "WGS84", "WGS84" },
+	{ "NAD83", "GRS80" },
+	{ "NAD27", "clrk66" },
+	{ "potsdam", "bessel" },
+	{ NULL, NULL }
+};
+
+// semi-major axis and squared eccentricity with the precedence of Proj,
+// false if the ellipsoid is not fully specified or unknown
+static bool ellipsoid(const std::map<std::string, std::string> &par, double &a, double &es)
+{
+	if (num_param(par, "R", a))
+	{
+		es = 0.0;
+		return (a > 0.0);
+	}
+
+	std::string ellps;
+	if (par.count("ellps"))
+		ellps = par.find("ellps")->second;
+	else if (par.count("datum"))
+	{
+		const std::string &datum = par.find("datum")->second;
+		for (int i = 0; Datums[i][0]; i++)
+			if (datum == Datums[i][0])
+				ellps = Datums[i][1];
+		if (ellps.empty())
+			return false;
+	}
+
+	bool shape = false;
+	double rf = 0.0;
+	a = 0.0;
+	if (!ellps.empty())
+	{
+		int i = 0;
+		while (Ellipsoids[i].name && (ellps != Ellipsoids[i].name))
+			i++;
+		if (!Ellipsoids[i].name)
+			return false;
+		a = Ellipsoids[i].a;
+		rf = Ellipsoids[i].rf;
+		shape = true;
+	}
+
+	num_param(par, "a", a);
+
+	double v;
+	if (num_param(par, "rf", v))
+	{
+		rf = v;
+		shape = true;
+	}
+	else if (num_param(par, "f", v))
+	{
+		rf = (v == 0.0) ? 0.0 : 1.0/v;
+		shape = true;
+	}
+	else if (num_param(par, "b", v))
+	{
+		rf = (v == a) ? 0.0 : a/(a-v);
+		shape = true;
+	}
+
+	if (!shape || (a <= 0.0))
+		return false;
+
+	double f = (rf == 0.0) ? 0.0 : 1.0/rf;
+	es = f*(2.0-f);
+	return (es >= 0.0) && (es < 1.0);
+}
+
+ScaleFactorBackend *analytic_backend(const char *proj4)
+{
+	std::map<std::string, std::string> par;
+	if (!parse_proj4(proj4, par))
+		return NULL;
+
+	// anything not in this list might change the geometry
+	static const char *known[] = { "proj", "R", "a", "b", "rf", "f", "ellps", "datum", "towgs84", "nadgrids",
+	                               "lat_0", "lat_ts", "lon_0", "k", "k_0", "x_0", "y_0", "units",
+	                               "pm", "over", "no_defs", "wktext", "type", NULL };
+	for (std::map<std::string, std::string>::const_iterator it = par.begin(); it != par.end(); ++it)
+	{
+		int i = 0;
+		while (known[i] && (it->first != known[i]))
+			i++;
+		if (!known[i])
+			return NULL;
+	}
+	if (par.count("units") && (par["units"] != "m"))
+		return NULL;
+
+	double a = 0.0, es = 0.0;
+	if (!ellipsoid(par, a, es))
+		return NULL;
+
+	const double deg = M_PI/180.0;
+	double lat_0 = 0.0, lat_ts = 0.0, k0 = 1.0, x0 = 0.0, y0 = 0.0;
+	num_param(par, "lat_0", lat_0);
+	bool has_ts = num_param(par, "lat_ts", lat_ts);
+	bool has_k = num_param(par, "k_0", k0) || num_param(par, "k", k0);
+	num_param(par, "x_0", x0);
+	num_param(par, "y_0", y0);
+	lat_0 *= deg;
+	lat_ts *= deg;
+
+	if (has_ts && (std::abs(lat_ts) >= M_PI/2) && (par["proj"] != "stere"))
+		return NULL;
+
+	const std::string &proj = par["proj"];
+
+	if (proj == "merc")
+	{
+		if (has_ts)
+			k0 = msfn(lat_ts, es);
+		return new MercatorBackend(a, es, k0, y0);
+	}
+
+	if (proj == "cea")
+	{
+		if (has_ts)
+			k0 = msfn(lat_ts, es);
+		return new CeaBackend(a, es, k0, y0);
+	}
+
+	// the remaining projections do not use k
+	if (proj == "stere")
+	{
+		bool north = (std::abs(lat_0 - M_PI/2) < 1.0e-10);
+		bool south = (std::abs(lat_0 + M_PI/2) < 1.0e-10);
+		if (!north && !south)
+			return NULL;
+		if (has_ts && ((lat_ts < 0.0) != south))
+			return NULL;
+		if (!has_ts)
+			lat_ts = lat_0;
+		return new PolarStereBackend(a, es, lat_ts, k0, x0, y0);
+	}
+
+	if (has_k && (k0 != 1.0))
+		return NULL;
+
+	if (proj == "eqc")
+		return new EqcBackend(a, es, lat_0, lat_ts, y0);
+
+	if ((proj == "longlat") || (proj == "latlong"))
+		return new GeographicBackend(a, es);
+
+	if (proj == "laea")
+	{
+		if ((es != 0.0) && (std::abs(std::abs(lat_0) - M_PI/2) > 1.0e-10))
+			return NULL;
+		return new LaeaBackend(a, es, lat_0, x0, y0);
+	}
+
+	return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// ScaleFactorGrid
+
+static std::atomic<size_t> TotalEvaluations(0);
+
+size_t ScaleFactorGrid::total_evaluations()
+{
+	return TotalEvaluations;
+}
+
+void ScaleFactorGrid::report_evaluations()
+{
+	TotalEvaluations += NEval - NEvalReported;
+	NEvalReported = NEval;
+}
+
+ScaleFactorGrid::ScaleFactorGrid(ScaleFactorBackend &backend, const double *geotransform, double tolerance):
+	Backend(backend), Tolerance(tolerance), NEval(0), NEvalReported(0), NPix(0), MaxErr(0.0)
+{
+	std::copy(geotransform, geotransform+6, GeoTransform);
+	RowMode = backend.separable() && (geotransform[2] == 0.0) && (geotransform[4] == 0.0);
+}
+
+void ScaleFactorGrid::fill(int x0, int y0, int w, int h, std::vector<ScaleFactors> &buf)
+{
+	buf.resize(size_t(w)*h);
+	Cache.clear();
+	TX0 = x0;
+	TY0 = y0;
+	TW = w;
+	TH = h;
+	Buf = &buf[0];
+
+	if (RowMode)
+	{
+		for (int py = y0; py < y0+h; py++)
+		{
+			ScaleFactors f = eval_row(py);
+			std::fill(&at(x0, py), &at(x0, py)+w, f);
+		}
+	}
+	else if (Tolerance <= 0.0)
+	{
+		for (int py = y0; py < y0+h; py++)
+			for (int px = x0; px < x0+w; px++)
+				at(px, py) = eval(px, py);
+	}
+	else
+	{
+		int bx0 = x0 - (x0 % BlockSize);
+		int by0 = y0 - (y0 % BlockSize);
+		for (int by = by0; by < y0+h; by += BlockSize)
+			for (int bx = bx0; bx < x0+w; bx += BlockSize)
+				fill_block(std::max(bx, x0), std::max(by, y0), std::min<int>(bx+BlockSize, x0+w), std::min<int>(by+BlockSize, y0+h));
+	}
+
+	NPix += size_t(w)*h;
+	report_evaluations();
+}
+
+ScaleFactors ScaleFactorGrid::pixel(int px, int py)
+{
+	NPix++;
+	ScaleFactors f = eval(px, py);
+	if (NEval - NEvalReported >= 1024)
+		report_evaluations();
+	return f;
+}
+
+static void update_max(double &scale, const ScaleFactors &f)
+{
+	if (f.ok)
+		scale = std::max(scale, std::max(f.h, f.k));
+}
+
+double ScaleFactorGrid::max_scale(int w, int h)
+{
+	double scale = 0.0;
+
+	if (RowMode)
+	{
+		for (int py = 0; py < h; py++)
+			update_max(scale, eval_row(py));
+		report_evaluations();
+		return scale;
+	}
+
+	for (int px = 0; px < w; px++)
+	{
+		update_max(scale, eval(px, 0));
+		update_max(scale, eval(px, h-1));
+	}
+	for (int py = 0; py < h; py++)
+	{
+		update_max(scale, eval(0, py));
+		update_max(scale, eval(w-1, py));
+	}
+
+	int step = std::max(1, std::max(w, h)/64);
+	for (int py = step/2; py < h; py += step)
+		for (int px = step/2; px < w; px += step)
+			update_max(scale, eval(px, py));
+
+	report_evaluations();
+	return scale;
+}
+
+ScaleFactors ScaleFactorGrid::eval(int px, int py)
+{
+	double x, y;
+	pixel_xy(px, py, x, y);
+	NEval++;
+	return Backend.factors(x, y);
+}
+
+// row mode evaluation, the factors of every row are only determined once
+const ScaleFactors &ScaleFactorGrid::eval_row(int py)
+{
+	if (size_t(py) >= Rows.size())
+	{
+		Rows.resize(py+1);
+		RowDone.resize(py+1, false);
+	}
+	if (!RowDone[py])
+	{
+		Rows[py] = eval(0, py);
+		RowDone[py] = true;
+	}
+	return Rows[py];
+}
+
+// evaluation with caching of the block corners shared between blocks
+const ScaleFactors &ScaleFactorGrid::eval_cached(int px, int py)
+{
+	unsigned long long key = ((unsigned long long)(unsigned int)px << 32) | (unsigned int)py;
+	std::unordered_map<unsigned long long, ScaleFactors>::iterator it = Cache.find(key);
+	if (it != Cache.end())
+		return it->second;
+	return Cache[key] = eval(px, py);
+}
+
+static double rel_err(double v, double ref)
+{
+	return std::abs(v-ref)/std::max(std::abs(ref), 1.0e-12);
+}
+
+static ScaleFactors interpolate(const ScaleFactors &c00, const ScaleFactors &c10,
+                                const ScaleFactors &c01, const ScaleFactors &c11,
+                                int x1, int y1, int xe, int ye, int px, int py)
+{
+	double fx = (xe > x1) ? double(px-x1)/(xe-x1) : 0.0;
+	double fy = (ye > y1) ? double(py-y1)/(ye-y1) : 0.0;
+	double w00 = (1.0-fx)*(1.0-fy);
+	double w10 = fx*(1.0-fy);
+	double w01 = (1.0-fx)*fy;
+	double w11 = fx*fy;
+
+	ScaleFactors f;
+	f.h = w00*c00.h + w10*c10.h + w01*c01.h + w11*c11.h;
+	f.k = w00*c00.k + w10*c10.k + w01*c01.k + w11*c11.k;
+	f.s = w00*c00.s + w10*c10.s + w01*c01.s + w11*c11.s;
+	f.ok = true;
+	return f;
+}
+
+// block covering pixels [x1,x2) x [y1,y2), corners at the outer pixel centers
+void ScaleFactorGrid::fill_block(int x1, int y1, int x2, int y2)
+{
+	// skip parts of the block outside the tile
+	if ((x2 <= TX0) || (x1 >= TX0+TW) || (y2 <= TY0) || (y1 >= TY0+TH))
+		return;
+
+	int xe = x2-1;
+	int ye = y2-1;
+
+	if ((x2-x1 <= 2) && (y2-y1 <= 2))
+	{
+		fill_exact(x1, y1, x2, y2);
+		return;
+	}
+
+	const ScaleFactors c00 = eval_cached(x1, y1);
+	const ScaleFactors c10 = eval_cached(xe, y1);
+	const ScaleFactors c01 = eval_cached(x1, ye);
+	const ScaleFactors c11 = eval_cached(xe, ye);
+
+	bool good = c00.ok && c10.ok && c01.ok && c11.ok;
+	double err = 0.0;
+
+	if (good)
+	{
+		const int xm = (x1+xe)/2;
+		const int ym = (y1+ye)/2;
+		const int chk[5][2] = { { xm, ym }, { xm, y1 }, { xm, ye }, { x1, ym }, { xe, ym } };
+
+		for (int i = 0; (i < 5) && good; i++)
+		{
+			const ScaleFactors &c = eval_cached(chk[i][0], chk[i][1]);
+			if (!c.ok)
+			{
+				good = false;
+				break;
+			}
+			ScaleFactors f = interpolate(c00, c10, c01, c11, x1, y1, xe, ye, chk[i][0], chk[i][1]);
+			err = std::max(err, rel_err(f.h, c.h));
+			err = std::max(err, rel_err(f.k, c.k));
+			err = std::max(err, rel_err(f.s, c.s));
+		}
+
+		if (err > Tolerance)
+			good = false;
+	}
+
+	if (!good)
+	{
+		int xs = (x2-x1 > 2) ? (x1+x2)/2 : x2;
+		int ys = (y2-y1 > 2) ? (y1+y2)/2 : y2;
+		fill_block(x1, y1, xs, ys);
+		if (xs < x2) fill_block(xs, y1, x2, ys);
+		if (ys < y2) fill_block(x1, ys, xs, y2);
+		if ((xs < x2) && (ys < y2)) fill_block(xs, ys, x2, y2);
+		return;
+	}
+
+	MaxErr = std::max(MaxErr, err);
+
+	for (int py = std::max(y1, TY0); py < std::min(y2, TY0+TH); py++)
+		for (int px = std::max(x1, TX0); px < std::min(x2, TX0+TW); px++)
+			at(px, py) = interpolate(c00, c10, c01, c11, x1, y1, xe, ye, px, py);
+}
+
+void ScaleFactorGrid::fill_exact(int x1, int y1, int x2, int y2)
+{
+	for (int py = y1; py < y2; py++)
+		for (int px = x1; px < x2; px++)
+			if (inside(px, py))
+				at(px, py) = eval_cached(px, py);
+}
+
+// ---------------------------------------------------------------------------
+// ScaleFactorErrors
+
+void ScaleFactorErrors::report(const ScaleFactorGrid &grid, int px, int py)
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+
+	if (Count < 1000)
+	{
+		double x, y;
+		grid.pixel_xy(px, py, x, y);
+		std::fprintf(stderr,"    failure to get scaling factor for %.2f/%.2f\n", x, y);
+		Count++;
+		if (Count == 1000)
+		{
+			std::fprintf(stderr,"    more than 1000 errors - not showing further errors.\n");
+		}
+	}
+}
+
+size_t ScaleFactorErrors::count() const
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+	return Count;
+}
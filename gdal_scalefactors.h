@@ -0,0 +1,320 @@
+/* ========================================================================
+    File: @(#)gdal_scalefactors.h
+   ------------------------------------------------------------------------
+    projection scale factor evaluation for the gdal-tools
+    Copyright (C) 2014-2015 Christoph Hormann <chris_hormann@gmx.de>
+   ------------------------------------------------------------------------
+
+    This file is part of gdal-tools
+
+    gdal-tools is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gdal-tools is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gdal-tools.  If not, see <http://www.gnu.org/licenses/>.
+
+   ========================================================================
+ */
+
+#ifndef GDAL_SCALEFACTORS_H
+#define GDAL_SCALEFACTORS_H
+
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+
+// projection scale factors at a pixel center
+struct ScaleFactors
+{
+	double h; // meridional scale
+	double k; // parallel scale
+	double s; // areal scale
+	bool ok;  // false if the factors could not be determined
+};
+
+// Source of the scale factors at points in projected coordinates.  Backends
+// are not thread safe, clone() creates an independent one for another thread.
+class ScaleFactorBackend
+{
+public:
+	virtual ~ScaleFactorBackend() {}
+
+	// factors at projected coordinates x/y
+	virtual ScaleFactors factors(double x, double y) = 0;
+	// true if the factors only depend on y
+	virtual bool separable() const = 0;
+	// short description for messages
+	virtual std::string name() const = 0;
+	// true if the projection is conformal, max(h,k) of a region is then
+	// always reached at its boundary
+	virtual bool conformal() const { return false; }
+
+	virtual ScaleFactorBackend *clone() const = 0;
+};
+
+// closed form factors of the spherical (web) mercator projection,
+// h = k = cosh(y/R) and s = h*k
+class WebMercatorBackend: public ScaleFactorBackend
+{
+public:
+	explicit WebMercatorBackend(double radius = 6378137.0): Radius(radius) {}
+
+	ScaleFactors factors(double x, double y);
+	bool separable() const { return true; }
+	bool conformal() const { return true; }
+	std::string name() const { return "web mercator"; }
+	ScaleFactorBackend *clone() const { return new WebMercatorBackend(Radius); }
+
+private:
+	double Radius;
+};
+
+// Closed form backends for common projections below, they are created by
+// analytic_backend() from the parameters of a proj4 definition.  All take
+// the semi-major axis a and the squared eccentricity es (0 for a sphere),
+// coordinates are in meters.
+
+// mercator (merc), sphere and ellipsoid, conformal
+class MercatorBackend: public ScaleFactorBackend
+{
+public:
+	MercatorBackend(double a, double es, double k0, double y0);
+
+	ScaleFactors factors(double x, double y);
+	bool separable() const { return true; }
+	bool conformal() const { return true; }
+	std::string name() const { return "mercator (analytic)"; }
+	ScaleFactorBackend *clone() const { return new MercatorBackend(*this); }
+
+private:
+	double A, Es, K0, Y0;
+	double Conformal[4];
+};
+
+// equidistant cylindrical (eqc), the coordinates are spherical like in Proj
+// (h = 1 on a sphere) and the factors are relative to the ellipsoid
+class EqcBackend: public ScaleFactorBackend
+{
+public:
+	EqcBackend(double a, double es, double lat_0, double lat_ts, double y0):
+		A(a), Es(es), Lat0(lat_0), CosTs(std::cos(lat_ts)), Y0(y0) {}
+
+	ScaleFactors factors(double x, double y);
+	bool separable() const { return true; }
+	std::string name() const { return "equidistant cylindrical (analytic)"; }
+	ScaleFactorBackend *clone() const { return new EqcBackend(*this); }
+
+private:
+	double A, Es, Lat0, CosTs, Y0;
+};
+
+// cylindrical equal area (cea), sphere and ellipsoid, h = 1/k
+class CeaBackend: public ScaleFactorBackend
+{
+public:
+	CeaBackend(double a, double es, double k0, double y0);
+
+	ScaleFactors factors(double x, double y);
+	bool separable() const { return true; }
+	std::string name() const { return "cylindrical equal area (analytic)"; }
+	ScaleFactorBackend *clone() const { return new CeaBackend(*this); }
+
+private:
+	double A, Es, K0, Y0;
+	double Qp;
+	double Authalic[3];
+};
+
+// Geographic coordinates in degrees (longlat).  The factors are in degrees
+// per meter on the ellipsoid so distances and areas are in meters.
+class GeographicBackend: public ScaleFactorBackend
+{
+public:
+	GeographicBackend(double a, double es): A(a), Es(es) {}
+
+	ScaleFactors factors(double x, double y);
+	bool separable() const { return true; }
+	std::string name() const { return "geographic (analytic)"; }
+	ScaleFactorBackend *clone() const { return new GeographicBackend(*this); }
+
+private:
+	double A, Es;
+};
+
+// polar stereographic (stere with lat_0 = +-90), sphere and ellipsoid,
+// conformal, with either lat_ts or k0 like in Proj; the south polar aspect
+// is the mirror image of the north polar one so lat_ts is taken as absolute
+class PolarStereBackend: public ScaleFactorBackend
+{
+public:
+	PolarStereBackend(double a, double es, double lat_ts, double k0, double x0, double y0);
+
+	ScaleFactors factors(double x, double y);
+	bool separable() const { return false; }
+	bool conformal() const { return true; }
+	std::string name() const { return "polar stereographic (analytic)"; }
+	ScaleFactorBackend *clone() const { return new PolarStereBackend(*this); }
+
+private:
+	double A, Es, X0, Y0;
+	double Akm1;  // rho/a = Akm1*t with the conformal t of Proj
+	double KPole; // scale at the pole
+	double Conformal[4];
+};
+
+// Lambert azimuthal equal area (laea), sphere in any aspect and ellipsoid
+// in polar aspect, s = 1 and h, k from the principal scales along and
+// across the direction to the center
+class LaeaBackend: public ScaleFactorBackend
+{
+public:
+	LaeaBackend(double a, double es, double lat_0, double x0, double y0);
+
+	ScaleFactors factors(double x, double y);
+	bool separable() const { return false; }
+	std::string name() const { return "lambert azimuthal equal area (analytic)"; }
+	ScaleFactorBackend *clone() const { return new LaeaBackend(*this); }
+
+private:
+	double A, Es, X0, Y0;
+	double SinLat0, CosLat0;
+	double Qp;
+	double Authalic[3];
+};
+
+// Closed form backend for a proj4 definition if one of the above covers it
+// exactly (projection, ellipsoid, aspect and units), NULL otherwise.
+ScaleFactorBackend *analytic_backend(const char *proj4);
+
+// Backend for a proj4 definition, an analytic one where available and Proj
+// otherwise.  Returns NULL after printing a message if the projection cannot
+// be used.  The caller owns the backend.  This is in a separate object of the
+// library (gdal_scalefactors_proj.cpp) so tools with only the analytic
+// backends do not depend on Proj.
+ScaleFactorBackend *create_backend(const char *proj4);
+
+// Evaluates scale factors for tiles of pixels of an image with the given
+// geotransform.  With a tolerance of zero every pixel is evaluated with the
+// backend.  Otherwise the factors are evaluated on a coarse grid of blocks
+// and bilinearly interpolated inside the blocks; blocks are split
+// recursively where the interpolation error at the block center and edge
+// midpoints exceeds the (relative) tolerance.
+// For separable backends and a geotransform without rotation the factors
+// only depend on y and are evaluated once per row, the rows evaluated are
+// cached so every row is only evaluated once.
+class ScaleFactorGrid
+{
+public:
+	enum { BlockSize = 64 };
+
+	ScaleFactorGrid(ScaleFactorBackend &backend, const double *geotransform, double tolerance);
+
+	// fill buf with factors of pixels [x0,x0+w) x [y0,y0+h) in row major order,
+	// blocks are aligned to multiples of BlockSize and clipped to the tile so
+	// results do not depend on the tiling as long as tiles are aligned as well.
+	void fill(int x0, int y0, int w, int h, std::vector<ScaleFactors> &buf);
+
+	// factors of a single pixel, evaluated directly
+	ScaleFactors pixel(int px, int py);
+
+	// true if fill() is cheaper than evaluating all pixels individually
+	bool interpolating() const { return RowMode || (Tolerance > 0.0); }
+
+	// estimate of the maximum of max(h,k) over an image of size w x h from
+	// the factors along the image boundary and on a coarse interior grid.
+	// For conformal projections the maximum is always on the boundary.
+	double max_scale(int w, int h);
+
+	// true if max_scale() is the exact maximum and not only an estimate,
+	// which is the case in row mode and for conformal projections
+	bool max_scale_exact() const { return RowMode || Backend.conformal(); }
+
+	// projection coordinates of a pixel center
+	void pixel_xy(int px, int py, double &x, double &y) const
+	{
+		x = GeoTransform[0] + GeoTransform[1] * (0.5+px) + GeoTransform[2] * (0.5+py);
+		y = GeoTransform[3] + GeoTransform[4] * (0.5+px) + GeoTransform[5] * (0.5+py);
+	}
+
+	ScaleFactorBackend &backend() const { return Backend; }
+
+	// true if factors are evaluated once per row
+	bool row_mode() const { return RowMode; }
+	// number of backend evaluations so far
+	size_t evaluations() const { return NEval; }
+	// number of pixels filled so far
+	size_t pixels() const { return NPix; }
+	// largest relative interpolation error found at the check points
+	double max_error() const { return MaxErr; }
+
+	// number of backend evaluations of all grids of the process so far,
+	// updated after every fill() and max_scale() and every 1024 pixel()
+	static size_t total_evaluations();
+
+private:
+	ScaleFactorBackend &Backend;
+	double GeoTransform[6];
+	double Tolerance;
+	bool RowMode;
+
+	size_t NEval;
+	size_t NEvalReported;
+	size_t NPix;
+	double MaxErr;
+
+	// current tile
+	int TX0, TY0, TW, TH;
+	ScaleFactors *Buf;
+
+	std::unordered_map<unsigned long long, ScaleFactors> Cache;
+
+	// factors of the rows evaluated so far in row mode
+	std::vector<ScaleFactors> Rows;
+	std::vector<bool> RowDone;
+
+	ScaleFactors &at(int px, int py)
+	{
+		return Buf[size_t(py-TY0)*TW + (px-TX0)];
+	}
+
+	bool inside(int px, int py) const
+	{
+		return (px >= TX0) && (px < TX0+TW) && (py >= TY0) && (py < TY0+TH);
+	}
+
+	ScaleFactors eval(int px, int py);
+	const ScaleFactors &eval_row(int py);
+	const ScaleFactors &eval_cached(int px, int py);
+
+	void fill_block(int x1, int y1, int x2, int y2);
+	void fill_exact(int x1, int y1, int x2, int y2);
+
+	void report_evaluations();
+};
+
+// Failures to determine scale factors, the first 1000 are reported with the
+// coordinates of the pixel.  Can be shared between threads.
+class ScaleFactorErrors
+{
+public:
+	ScaleFactorErrors(): Count(0) {}
+
+	void report(const ScaleFactorGrid &grid, int px, int py);
+	size_t count() const;
+
+private:
+	mutable std::mutex Mutex;
+	size_t Count;
+};
+
+#endif
@@ -0,0 +1,129 @@
+/* ========================================================================
+    File: @(#)gdal_scalefactors_proj.cpp
+   ------------------------------------------------------------------------
+    projection scale factors with Proj for the gdal-tools
+    Copyright (C) 2014-2015 Christoph Hormann <chris_hormann@gmx.de>
+   ------------------------------------------------------------------------
+
+    This file is part of gdal-tools
+
+    gdal-tools is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gdal-tools is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gdal-tools.  If not, see <http://www.gnu.org/licenses/>.
+
+   ========================================================================
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include <projects.h>
+#include <proj_api.h>
+
+#include "gdal_scalefactors_proj.h"
+
+ProjBackend::ProjBackend(const char *proj4):
+	Proj4(proj4), Ctx(pj_ctx_alloc()), Proj(NULL), Separable(separable(proj4)), Conformal(conformal(proj4))
+{
+	Proj = pj_init_plus_ctx(Ctx, proj4);
+}
+
+ProjBackend::~ProjBackend()
+{
+	if (Proj)
+		pj_free(Proj);
+	pj_ctx_free(Ctx);
+}
+
+bool ProjBackend::invertible() const
+{
+	return Proj && Proj->inv;
+}
+
+ScaleFactors ProjBackend::factors(double x, double y)
+{
+	ScaleFactors f;
+	struct FACTORS facs;
+
+	projUV dat_xy;
+	dat_xy.u = x;
+	dat_xy.v = y;
+	projUV dat_ll = pj_inv(dat_xy, Proj);
+
+	f.ok = (pj_factors(dat_ll, Proj, 0.0, &facs) == 0);
+	f.h = facs.h;
+	f.k = facs.k;
+	f.s = facs.s;
+	return f;
+}
+
+// name of the projection of a proj4 definition
+static std::string projection(const char *proj4)
+{
+	const char *p = std::strstr(proj4, "+proj=");
+	if (!p)
+		return std::string();
+	p += std::strlen("+proj=");
+	return std::string(p, std::strcspn(p, " "));
+}
+
+static bool listed(const std::string &name, const char **names)
+{
+	for (int i = 0; names[i]; i++)
+		if (name == names[i])
+			return true;
+	return false;
+}
+
+bool ProjBackend::separable(const char *proj4)
+{
+	static const char *cylindrical[] = { "merc", "webmerc", "eqc", "cea", "mill", "gall", "cc", NULL };
+
+	return listed(projection(proj4), cylindrical);
+}
+
+bool ProjBackend::conformal(const char *proj4)
+{
+	static const char *names[] = { "merc", "webmerc", "tmerc", "etmerc", "utm", "lcc", "stere", "sterea", "ups", NULL };
+
+	return listed(projection(proj4), names);
+}
+
+ScaleFactorBackend *create_backend(const char *proj4)
+{
+	ScaleFactorBackend *backend = analytic_backend(proj4);
+	if (backend)
+	{
+		std::fprintf(stderr,"  scale factors: %s\n", backend->name().c_str());
+		return backend;
+	}
+
+	ProjBackend *proj = new ProjBackend(proj4);
+
+	if (!proj->valid())
+	{
+		std::fprintf(stderr,"  Initializing projection in Proj4 failed.\n\n");
+		delete proj;
+		return NULL;
+	}
+
+	if (!proj->invertible())
+	{
+		std::fprintf(stderr,"  inverse not known for projection.\n\n");
+		delete proj;
+		return NULL;
+	}
+
+	std::fprintf(stderr,"  scale factors: %s\n", proj->name().c_str());
+	return proj;
+}
+
@@ -0,0 +1,71 @@
+/* ========================================================================
+    File: @(#)gdal_scalefactors_proj.h
+   ------------------------------------------------------------------------
+    projection scale factors with Proj for the gdal-tools
+    Copyright (C) 2014-2015 Christoph Hormann <chris_hormann@gmx.de>
+   ------------------------------------------------------------------------
+
+    This file is part of gdal-tools
+
+    gdal-tools is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    gdal-tools is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with gdal-tools.  If not, see <http://www.gnu.org/licenses/>.
+
+   ========================================================================
+ */
+
+#ifndef GDAL_SCALEFACTORS_PROJ_H
+#define GDAL_SCALEFACTORS_PROJ_H
+
+#include <string>
+
+#include <proj_api.h>
+
+#include "gdal_scalefactors.h"
+
+// generic backend with pj_inv() + pj_factors(), every instance has its own
+// Proj context so instances can be used in different threads
+class ProjBackend: public ScaleFactorBackend
+{
+public:
+	explicit ProjBackend(const char *proj4);
+	~ProjBackend();
+
+	// false if Proj could not initialize the projection
+	bool valid() const { return Proj != NULL; }
+	// false if the inverse projection is not available
+	bool invertible() const;
+
+	ScaleFactors factors(double x, double y);
+	bool separable() const { return Separable; }
+	std::string name() const { return "Proj"; }
+	bool conformal() const { return Conformal; }
+	ScaleFactorBackend *clone() const { return new ProjBackend(Proj4.c_str()); }
+
+	// true if the scale factors of a proj4 definition only depend on y,
+	// which is the case for cylindrical projections in normal aspect
+	static bool separable(const char *proj4);
+	// true for the common conformal projections
+	static bool conformal(const char *proj4);
+
+private:
+	std::string Proj4;
+	projCtx Ctx;
+	projPJ Proj;
+	bool Separable;
+	bool Conformal;
+
+	ProjBackend(const ProjBackend &);
+	ProjBackend &operator=(const ProjBackend &);
+};
+
+#endif
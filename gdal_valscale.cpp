@@ -23,16 +23,32 @@
     Version history:
 
       0.1: initial public version, September 2014
+      0.2: optional interpolated scale factor grid, October 2026
+      0.3: processing in strips with limited memory use, October 2026
+      0.4: multithreaded scaling, October 2026
+      0.5: shared scale factor library, October 2026
+      0.6: analytic scale factors for common projections, October 2026
+      0.7: optional output to a new file written in the background, October 2026
+      0.8: strips read ahead in the background, October 2026
+      0.9: processing in the native data type, band sequential, October 2026
+      0.10: nodata and masks, blocks without data are skipped, October 2026
+      0.11: per phase profile (GDAL_TOOLS_PROFILE), October 2026
 
    ========================================================================
  */
 
-const char PROGRAM_TITLE[] = "gdal_valscale 0.1";
+const char PROGRAM_TITLE[] = "gdal_valscale 0.11";
 
 #include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <vector>
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <thread>
+#include <atomic>
 
 #include <gdal_priv.h>
 #include <ogrsf_frmts.h>
@@ -41,6 +57,250 @@ const char PROGRAM_TITLE[] = "gdal_valscale 0.1";
 #include <projects.h>
 #include <proj_api.h>
 
+#include "gdal_scalefactors.h"
+#include "gdal_iothread.h"
+#include "gdal_profile.h"
+#include "gdal_output.h"
+
+// per thread state of the scaling loop, scale factor backends cannot be
+// shared between threads so every worker has its own
+struct ScaleWorker
+{
+	ScaleFactorBackend *Backend;
+	ScaleFactorGrid *Grid;
+	std::vector<ScaleFactors> Facs;
+	std::vector<double> Scale;
+	double MinScale;
+	double MaxScale;
+};
+
+static ScaleFactorErrors Errors;
+
+// Invalid pixels of a band, either pixels of the nodata value or pixels
+// with zero in a mask plane read along with the data (for masks not given
+// by a nodata value)
+struct BandValidity
+{
+	bool AllValid;
+	double Nodata;
+	bool NodataNaN;
+	int MaskPlane;
+};
+
+// layout of the strips, bands and mask planes one after the other with
+// BandSize pixels each.  Data is skipped in columns of blocks of the file.
+struct StripLayout
+{
+	int XSize;
+	int Bands;
+	size_t BandSize;
+	int BlockXSize;
+	int BlockCols;
+	bool AllValid;
+	std::vector<BandValidity> Validity;
+};
+
+// scaled value of a pixel, integer types are rounded to the nearest value
+// and saturated at the limits of the type
+template <typename T> static inline T scale_value(T v, double s)
+{
+	double r = std::round(double(v)*s);
+	if (r <= double(std::numeric_limits<T>::min()))
+		return std::numeric_limits<T>::min();
+	if (r >= double(std::numeric_limits<T>::max()))
+		return std::numeric_limits<T>::max();
+	return T(r);
+}
+
+static inline float scale_value(float v, double s) { return float(v*s); }
+static inline double scale_value(double v, double s) { return v*s; }
+
+// scale a run of n pixels of a band with the factors s
+template <typename T> static void scale_run(T *p, const double *s, int n)
+{
+	for (int i = 0; i < n; i++)
+		p[i] = scale_value(p[i], s[i]);
+}
+
+// true if pixel i of a band is valid
+template <typename T>
+static inline bool pixel_valid(const StripLayout &l, int band, const T *pData, const unsigned char *pMask, size_t i)
+{
+	const BandValidity &v = l.Validity[band];
+	if (v.AllValid)
+		return true;
+	if (v.MaskPlane >= 0)
+		return pMask[v.MaskPlane*l.BandSize + i] != 0;
+	double d = pData[band*l.BandSize + i];
+	return v.NodataNaN ? (d == d) : (d != v.Nodata);
+}
+
+// true if any band has valid pixels in [x1,x2) of row r of a strip
+template <typename T>
+static bool any_valid(const StripLayout &l, const T *pData, const unsigned char *pMask, int r, int x1, int x2)
+{
+	if (l.AllValid)
+		return true;
+	for (int band = 0; band < l.Bands; band++)
+		for (size_t i = size_t(r)*l.XSize+x1; i < size_t(r)*l.XSize+x2; i++)
+			if (pixel_valid(l, band, pData, pMask, i))
+				return true;
+	return false;
+}
+
+// Scale rows [y1,y2) of a strip starting at y0, at most one block of the
+// scale factor grid high.  Which block columns of each row contain valid
+// pixels is recorded in pRowValid, columns without any in all rows are
+// skipped including the factor evaluation.  The factors of a pixel are
+// determined once for all bands, invalid pixels and pixels without valid
+// factor are scaled by 1 so they keep their values.
+template <typename T>
+static void scale_rows(ScaleWorker &w, const StripLayout &l, T *pData, const unsigned char *pMask, char *pRowValid, int y0, int y1, int y2)
+{
+	int nXSize = l.XSize;
+	w.Scale.resize(size_t(l.AllValid ? 1 : l.Bands)*nXSize);
+
+	std::vector<char> col_valid(l.BlockCols, 0);
+	for (int py = y1; py < y2; py++)
+		for (int c = 0; c < l.BlockCols; c++)
+		{
+			char &valid = pRowValid[size_t(py-y0)*l.BlockCols + c];
+			valid = any_valid(l, pData, pMask, py-y0, c*l.BlockXSize, std::min(nXSize, (c+1)*l.BlockXSize));
+			col_valid[c] |= valid;
+		}
+
+	for (int c1 = 0; c1 < l.BlockCols; )
+	{
+		if (!col_valid[c1])
+		{
+			c1++;
+			continue;
+		}
+		int c2 = c1+1;
+		while ((c2 < l.BlockCols) && col_valid[c2])
+			c2++;
+
+		int x1 = c1*l.BlockXSize;
+		int x2 = std::min(nXSize, c2*l.BlockXSize);
+		c1 = c2;
+
+		w.Grid->fill(x1, y1, x2-x1, y2-y1, w.Facs);
+
+		for (int py = y1; py < y2; py++)
+		{
+			const ScaleFactors *facs_row = &w.Facs[size_t(py-y1)*(x2-x1)];
+			size_t row = size_t(py-y0)*nXSize;
+
+			for (int px = x1; px < x2; px++)
+			{
+				const ScaleFactors &facs = facs_row[px-x1];
+				bool any = l.AllValid;
+				for (int band = 0; band < l.Bands && !l.AllValid; band++)
+				{
+					bool valid = pixel_valid(l, band, pData, pMask, row+px);
+					w.Scale[size_t(band)*nXSize+px] = (valid && facs.ok) ? facs.s : 1.0;
+					any = any || valid;
+				}
+
+				if (!any)
+					continue;
+
+				if (facs.ok)
+				{
+					w.MinScale = std::min(w.MinScale, facs.s);
+					w.MaxScale = std::max(w.MaxScale, facs.s);
+				}
+				else
+					Errors.report(*w.Grid, px, py);
+
+				if (l.AllValid)
+					w.Scale[px] = facs.ok ? facs.s : 1.0;
+			}
+
+			for (int band = 0; band < l.Bands; band++)
+				scale_run(&pData[band*l.BandSize + row + x1], &w.Scale[(l.AllValid ? 0 : size_t(band)*nXSize) + x1], x2-x1);
+		}
+	}
+}
+
+// data types processed natively, others are processed as Float64
+static bool native_type(GDALDataType eType)
+{
+	switch (eType)
+	{
+		case GDT_Byte:
+		case GDT_UInt16:
+		case GDT_Int16:
+		case GDT_UInt32:
+		case GDT_Int32:
+		case GDT_Float32:
+		case GDT_Float64:
+			return true;
+		default:
+			return false;
+	}
+}
+
+static void scale_rows(ScaleWorker &w, const StripLayout &l, GDALDataType eType, void *pData, const unsigned char *pMask, char *pRowValid, int y0, int y1, int y2)
+{
+	switch (eType)
+	{
+		case GDT_Byte: scale_rows(w, l, (GByte *) pData, pMask, pRowValid, y0, y1, y2); break;
+		case GDT_UInt16: scale_rows(w, l, (GUInt16 *) pData, pMask, pRowValid, y0, y1, y2); break;
+		case GDT_Int16: scale_rows(w, l, (GInt16 *) pData, pMask, pRowValid, y0, y1, y2); break;
+		case GDT_UInt32: scale_rows(w, l, (GUInt32 *) pData, pMask, pRowValid, y0, y1, y2); break;
+		case GDT_Int32: scale_rows(w, l, (GInt32 *) pData, pMask, pRowValid, y0, y1, y2); break;
+		case GDT_Float32: scale_rows(w, l, (float *) pData, pMask, pRowValid, y0, y1, y2); break;
+		default: scale_rows(w, l, (double *) pData, pMask, pRowValid, y0, y1, y2); break;
+	}
+}
+
+// Write rows [y0,y0+nRows) of a strip.  With a list of the blocks with
+// valid pixels (rows of blocks of nBlockYSize x columns) only these are
+// written, all others are unchanged.
+static bool write_strip(GDALDataset *poDataset, const StripLayout &l, GDALDataType eType, void *pData, int y0, int nRows,
+                        int nBlockYSize, const std::vector<char> &blocks)
+{
+	int nTypeSize = GDALGetDataTypeSize(eType)/8;
+	GSpacing nPixelSpace = nTypeSize;
+	GSpacing nLineSpace = nPixelSpace*l.XSize;
+	GSpacing nBandSpace = nPixelSpace*l.BandSize;
+
+	if (blocks.empty())
+	{
+		if (poDataset->RasterIO( GF_Write, 0, y0, l.XSize, nRows, pData, l.XSize, nRows, eType, l.Bands, NULL, nPixelSpace, nLineSpace, nBandSpace) != CE_None)
+			return false;
+		profile().written(size_t(nTypeSize)*l.XSize*nRows*l.Bands);
+		return true;
+	}
+
+	for (int by = 0; by*nBlockYSize < nRows; by++)
+	{
+		int y1 = by*nBlockYSize;
+		int h = std::min(nBlockYSize, nRows-y1);
+		for (int c1 = 0; c1 < l.BlockCols; )
+		{
+			if (!blocks[size_t(by)*l.BlockCols + c1])
+			{
+				c1++;
+				continue;
+			}
+			int c2 = c1+1;
+			while ((c2 < l.BlockCols) && blocks[size_t(by)*l.BlockCols + c2])
+				c2++;
+
+			int x1 = c1*l.BlockXSize;
+			int w = std::min(l.XSize, c2*l.BlockXSize) - x1;
+			char *p = (char *) pData + (size_t(y1)*l.XSize + x1)*nTypeSize;
+			if (poDataset->RasterIO( GF_Write, x1, y0+y1, w, h, p, w, h, eType, l.Bands, NULL, nPixelSpace, nLineSpace, nBandSpace) != CE_None)
+				return false;
+			profile().written(size_t(nTypeSize)*w*h*l.Bands);
+			c1 = c2;
+		}
+	}
+	return true;
+}
+
 int main(int argc,char **argv)
 {
 	std::fprintf(stderr,"%s\n", PROGRAM_TITLE);
@@ -50,26 +310,51 @@ int main(int argc,char **argv)
 	std::fprintf(stderr,"This is free software, and you are welcome to redistribute\n");
 	std::fprintf(stderr,"it under certain conditions; see COPYING for details.\n");
 
-	// only have one parameter
+	profile().begin(PROGRAM_TITLE);
+
+	// one parameter: file name, options:
+	//   -t <tolerance>: interpolate scale factors with the given relative error
+	//   -m <MB>: size of the processing window
+	//   -j <threads>: number of threads
+	//   -o/-of/-co: output file, format and creation options
+
+	double tolerance = 0.0;
+	size_t window_mb = 256;
+	int nThreads = std::max(1u, std::thread::hardware_concurrency());
+	OutputDataset output;
+	std::vector<char *> args;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (output.option(argc, argv, i))
+			continue;
+		else if ((std::strcmp(argv[i], "-t") == 0) && (i+1 < argc))
+			tolerance = atof(argv[++i]);
+		else if ((std::strcmp(argv[i], "-m") == 0) && (i+1 < argc))
+			window_mb = std::max(1, atoi(argv[++i]));
+		else if ((std::strcmp(argv[i], "-j") == 0) && (i+1 < argc))
+			nThreads = std::max(1, atoi(argv[++i]));
+		else
+			args.push_back(argv[i]);
+	}
 
-	if (argc <= 1)
+	if (args.size() < 1)
 	{
-		std::fprintf(stderr,"  You need to supply an image file name as parameter\n\n");
+		std::fprintf(stderr,"  You need to supply an image file name as parameter\n");
+		std::fprintf(stderr,"  options:\n");
+		std::fprintf(stderr,"    -t <tolerance>  interpolate scale factors with given maximum relative error\n");
+		std::fprintf(stderr,"    -m <MB>         size of the processing window (default: %ld MB)\n", window_mb);
+		std::fprintf(stderr,"    -j <threads>    number of threads (default: %d)\n", nThreads);
+		OutputDataset::usage();
+		std::fprintf(stderr,"\n");
 		std::exit(1);
 	}
 
-	char *fnm = argv[1];
+	char *fnm = args[0];
 
 	GDALAllRegister();
 
-	GDALDataset  *poDataset;
-
-	poDataset = (GDALDataset *) GDALOpen( fnm, GA_Update );
-	if( poDataset == NULL )
-	{
-		std::fprintf(stderr,"  opening file %s failed.\n\n", fnm);
-		std::exit(1);
-	}
+	GDALDataset  *poDataset = output.open(fnm);
 
 	int nXSize = poDataset->GetRasterXSize();
 	int nYSize = poDataset->GetRasterYSize();
@@ -93,83 +378,267 @@ int main(int argc,char **argv)
 	char *str_proj4;
 	oSRS->exportToProj4(&str_proj4);
 
-	projPJ Proj = pj_init_plus(str_proj4);
+	std::fprintf(stderr,"  proj4: %s/\n", str_proj4);
 
-	if (!Proj)
-	{
-		std::fprintf(stderr,"  Initializing projection in Proj4 failed.\n\n");
+	ScaleFactorBackend *backend = create_backend(str_proj4);
+	if (!backend)
 		std::exit(1);
+
+	int nBands = poDataset->GetRasterCount();
+
+	// scaling complex values is not defined, processing them as Float64
+	// would drop the imaginary part
+	for (int band = 1; band <= nBands; band++)
+		if (GDALDataTypeIsComplex(poDataset->GetRasterBand(band)->GetRasterDataType()))
+		{
+			std::fprintf(stderr,"  complex data (band %d) is not supported.\n\n", band);
+			std::exit(1);
+		}
+
+	// the data is processed in the type of the bands if they all have the
+	// same one and it is supported, otherwise as Float64 which holds the
+	// values of all other types
+	GDALDataType eType = poDataset->GetRasterBand(1)->GetRasterDataType();
+	for (int band = 2; band <= nBands; band++)
+		if (poDataset->GetRasterBand(band)->GetRasterDataType() != eType)
+			eType = GDT_Float64;
+	if (!native_type(eType))
+		eType = GDT_Float64;
+	int nTypeSize = GDALGetDataTypeSize(eType)/8;
+
+	// Invalid pixels keep their values, they are found by the nodata values
+	// of the bands or by their mask bands which are read along with the
+	// data then (one for all bands with a per dataset mask).
+	int nBlockXSize, nBlockYSize;
+	poDataset->GetRasterBand(1)->GetBlockSize(&nBlockXSize, &nBlockYSize);
+
+	StripLayout layout;
+	layout.XSize = nXSize;
+	layout.Bands = nBands;
+	layout.BlockXSize = std::max(1, std::min(nBlockXSize, nXSize));
+	layout.BlockCols = (nXSize+layout.BlockXSize-1)/layout.BlockXSize;
+	layout.AllValid = true;
+
+	std::vector<GDALRasterBand *> mask_bands;
+	int dataset_plane = -1;
+	for (int band = 1; band <= nBands; band++)
+	{
+		GDALRasterBand *poBand = poDataset->GetRasterBand(band);
+		int flags = poBand->GetMaskFlags();
+		int has_nodata = FALSE;
+
+		BandValidity v;
+		v.AllValid = (flags & GMF_ALL_VALID) != 0;
+		v.Nodata = poBand->GetNoDataValue(&has_nodata);
+		if (poBand->GetRasterDataType() == GDT_Float32)
+			v.Nodata = float(v.Nodata);
+		v.NodataNaN = std::isnan(v.Nodata);
+		v.MaskPlane = -1;
+
+		if (!v.AllValid && !(flags & GMF_NODATA))
+		{
+			if ((flags & GMF_PER_DATASET) && (dataset_plane >= 0))
+				v.MaskPlane = dataset_plane;
+			else
+			{
+				v.MaskPlane = mask_bands.size();
+				mask_bands.push_back(poBand->GetMaskBand());
+				if (flags & GMF_PER_DATASET)
+					dataset_plane = v.MaskPlane;
+			}
+		}
+
+		layout.AllValid = layout.AllValid && v.AllValid;
+		layout.Validity.push_back(v);
 	}
+	int nMaskPlanes = mask_bands.size();
 
-	std::fprintf(stderr,"  proj4: %s/\n", str_proj4);
+	if (!layout.AllValid)
+		std::fprintf(stderr,"  skipping nodata pixels (%d mask bands)\n", nMaskPlanes);
+
+	// process the image in strips of whole rows aligned to the block layout
+	// of the input and output files and the scale factor grid, memory use is
+	// limited by the window size.  The next strip is read while one is scaled
+	// and with a new output file the previous one is written at the same time
+	// so the window is shared by two or three strips.
+
+	int nOutBlockXSize, nOutBlockYSize;
+	output.band(1)->GetBlockSize(&nOutBlockXSize, &nOutBlockYSize);
+
+	int nBuffers = output.in_place() ? 2 : 3;
+	size_t window = window_mb*1024*1024/nBuffers;
 
-	if (!Proj->inv)
+	int nStripAlign = nBlockYSize;
+	while ((nStripAlign % ScaleFactorGrid::BlockSize != 0) || (nStripAlign % nOutBlockYSize != 0))
+		nStripAlign += nBlockYSize;
+	size_t nRowBytes = size_t(nXSize)*(nBands*nTypeSize + nMaskPlanes);
+	if (nStripAlign*nRowBytes > window)
+		nStripAlign = nBlockYSize;
+
+	int nStripRows = window/nRowBytes;
+	nStripRows = std::max(nStripAlign, nStripRows - (nStripRows % nStripAlign));
+	nStripRows = std::min(nStripRows, nYSize);
+
+	std::fprintf(stderr,"  allocating memory (%d strips of %dx%dx%d)...\n", nBuffers, nXSize, nStripRows, nBands);
+	profile().phase("allocating memory");
+
+	std::vector<void *> pBuffers(nBuffers);
+	std::vector<unsigned char *> pMasks(nBuffers, NULL);
+	for (int i = 0; i < nBuffers; i++)
 	{
-		std::fprintf(stderr,"  inverse not known for projection.\n\n");
-		std::exit(1);
+		pBuffers[i] = CPLMalloc(size_t(nTypeSize)*nXSize*nStripRows*nBands);
+		if (nMaskPlanes > 0)
+			pMasks[i] = (unsigned char *) CPLMalloc(size_t(nXSize)*nStripRows*nMaskPlanes);
 	}
 
-	std::fprintf(stderr,"  allocating memory (%dx%dx%d)...\n", nXSize, nYSize, poDataset->GetRasterCount());
+	std::fprintf(stderr,"  scaling values in strips of %d rows (block size %dx%d)...\n", nStripRows, nBlockXSize, nBlockYSize);
+	profile().phase("scaling values");
 
-	float * pData = (float *) CPLMalloc(sizeof(float)*nXSize*nYSize*poDataset->GetRasterCount());
+	std::fprintf(stderr,"    processing as %s\n", GDALGetDataTypeName(eType));
 
-	std::fprintf(stderr,"  reading data...\n");
+	std::fprintf(stderr,"    using %d threads\n", nThreads);
 
-	if( poDataset->RasterIO( GF_Read, 0, 0, nXSize, nYSize, pData, nXSize, nYSize, GDT_Float32, poDataset->GetRasterCount(), NULL, 0, 0, 0) != CE_None )
+	std::vector<ScaleWorker> workers(nThreads);
+	for (int i = 0; i < nThreads; i++)
 	{
-		std::fprintf(stderr,"  reading data failed.\n\n");
-		std::exit(1);
+		workers[i].Backend = backend->clone();
+		workers[i].Grid = new ScaleFactorGrid(*workers[i].Backend, adfGeoTransform, tolerance);
+		workers[i].MinScale = 1.0e12;
+		workers[i].MaxScale = -1.0e12;
 	}
 
-	std::fprintf(stderr,"  scaling values...\n");
+	if (workers[0].Grid->row_mode())
+		std::fprintf(stderr,"    separable projection - evaluating scale factors once per row\n");
 
-	double min_scale = 1.0e12;
-	double max_scale = -1.0e12;
+	// band sequential layout so a factor is applied to whole rows of a band
+	size_t nBandSize = size_t(nXSize)*nStripRows;
+	layout.BandSize = nBandSize;
+	GSpacing nPixelSpace = nTypeSize;
+	GSpacing nLineSpace = nPixelSpace*nXSize;
+	GSpacing nBandSpace = nPixelSpace*nBandSize;
 
-	size_t cnterr = 0;
-	for (int py = 0; py < nYSize; py++)
+	IOThread reader;
+	auto read = [&](int y0)
 	{
-		for (int px = 0; px < nXSize; px++)
+		int nRows = std::min(nStripRows, nYSize-y0);
+		void *pData = pBuffers[(y0/nStripRows) % nBuffers];
+		unsigned char *pMask = pMasks[(y0/nStripRows) % nBuffers];
+		reader.start([=, &mask_bands]()
 		{
-			projUV dat_xy;
-			struct FACTORS facs;
+			if (poDataset->RasterIO( GF_Read, 0, y0, nXSize, nRows, pData, nXSize, nRows, eType, nBands, NULL, nPixelSpace, nLineSpace, nBandSpace) != CE_None)
+				return false;
+			for (int i = 0; i < nMaskPlanes; i++)
+				if (mask_bands[i]->RasterIO( GF_Read, 0, y0, nXSize, nRows, pMask + i*nBandSize, nXSize, nRows, GDT_Byte, 0, 0 ) != CE_None)
+					return false;
+			profile().read(size_t(nXSize)*nRows*(nBands*nTypeSize + nMaskPlanes));
+			return true;
+		});
+	};
+
+	read(0);
+
+	// block columns with valid pixels for every row of a strip
+	std::vector<char> row_valid(size_t(nStripRows)*layout.BlockCols);
+	size_t nBlocks = 0;
+	size_t nSkipped = 0;
+
+	for (int y0 = 0; y0 < nYSize; y0 += nStripRows)
+	{
+		int nRows = std::min(nStripRows, nYSize-y0);
+		void *pData = pBuffers[(y0/nStripRows) % nBuffers];
+		unsigned char *pMask = pMasks[(y0/nStripRows) % nBuffers];
 
-			dat_xy.u = adfGeoTransform[0] + adfGeoTransform[1] * (0.5+px) + adfGeoTransform[2] * (0.5+py);
-			dat_xy.v = adfGeoTransform[3] + adfGeoTransform[4] * (0.5+px) + adfGeoTransform[5] * (0.5+py);
+		if (!reader.wait())
+		{
+			std::fprintf(stderr,"  reading data failed.\n\n");
+			std::exit(1);
+		}
 
-			projUV dat_ll = pj_inv(dat_xy, Proj);
+		if (y0+nStripRows < nYSize)
+			read(y0+nStripRows);
 
-			int facs_bad = pj_factors(dat_ll, Proj, 0.0, &facs);
+		// threads take chunks of rows matching the scale factor grid blocks
+		std::atomic<int> next_chunk(0);
+		int nChunks = (nRows+ScaleFactorGrid::BlockSize-1)/ScaleFactorGrid::BlockSize;
 
-			if (!facs_bad)
-			{
-				for (int band = 0; band < poDataset->GetRasterCount(); band++)
-				{
-					size_t i = poDataset->GetRasterCount()*(py*nXSize+px)+band;
-					pData[i] *= facs.s;
-					min_scale = std::min(min_scale, facs.s);
-					max_scale = std::max(max_scale, facs.s);
-				}
-				//std::fprintf(stderr,"    (%.2f/%.2f) -> (%.2f/%.2f), %.2f\n", dat_xy.u, dat_xy.v, dat_ll.u, dat_ll.v, facs.s);
-			}
-			else if (cnterr < 1000)
+		std::vector<std::thread> threads;
+		for (int i = 0; i < nThreads; i++)
+		{
+			threads.push_back(std::thread([&, i]()
 			{
-				std::fprintf(stderr,"    failure to get scaling factor for %.2f/%.2f\n", dat_xy.u, dat_xy.v);
-				cnterr++;
-				if (cnterr == 1000)
+				int c;
+				while ((c = next_chunk++) < nChunks)
 				{
-					std::fprintf(stderr,"    more than 1000 errors - not showing further errors.\n");
+					int y1 = y0 + c*ScaleFactorGrid::BlockSize;
+					scale_rows(workers[i], layout, eType, pData, pMask, &row_valid[0], y0, y1, std::min<int>(y1+ScaleFactorGrid::BlockSize, y0+nRows));
 				}
-			}
+			}));
 		}
+		for (size_t i = 0; i < threads.size(); i++)
+			threads[i].join();
+
+		profile().pixels(size_t(nXSize)*nRows);
+
+		// blocks of the file with valid pixels, in place the others are not
+		// written back
+		int nBlockRows = (nRows+nBlockYSize-1)/nBlockYSize;
+		std::vector<char> blocks(size_t(nBlockRows)*layout.BlockCols, 0);
+		for (int r = 0; r < nRows; r++)
+			for (int c = 0; c < layout.BlockCols; c++)
+				blocks[size_t(r/nBlockYSize)*layout.BlockCols + c] |= row_valid[size_t(r)*layout.BlockCols + c];
+		size_t nEmpty = std::count(blocks.begin(), blocks.end(), 0);
+		nBlocks += blocks.size();
+		nSkipped += nEmpty;
+		if ((nEmpty == 0) || !output.in_place())
+			blocks.clear();
+
+		// in place the input must not be read while writing
+		if (output.in_place() && !reader.wait())
+		{
+			std::fprintf(stderr,"  reading data failed.\n\n");
+			std::exit(1);
+		}
+
+		GDALDataset *poOutput = output.dataset();
+		output.write([=, &layout]()
+		{
+			return write_strip(poOutput, layout, eType, pData, y0, nRows, nBlockYSize, blocks);
+		});
 	}
 
+	output.close();
+
+	double min_scale = 1.0e12;
+	double max_scale = -1.0e12;
+	size_t evaluations = 0;
+	size_t pixels = 0;
+	double max_error = 0.0;
+
+	for (int i = 0; i < nThreads; i++)
+	{
+		min_scale = std::min(min_scale, workers[i].MinScale);
+		max_scale = std::max(max_scale, workers[i].MaxScale);
+		evaluations += workers[i].Grid->evaluations();
+		pixels += workers[i].Grid->pixels();
+		max_error = std::max(max_error, workers[i].Grid->max_error());
+	}
+
+	if ((tolerance > 0.0) || workers[0].Grid->row_mode())
+		std::fprintf(stderr,"    %ld scale factor evaluations for %ld pixels, maximum interpolation error: %.2g\n", evaluations, pixels, max_error);
 	std::fprintf(stderr,"    maximum scaling: %.4f, minimum scaling: %.4f\n", max_scale, min_scale);
-	std::fprintf(stderr,"  writing data...\n");
+	if (!layout.AllValid)
+		std::fprintf(stderr,"    %ld of %ld blocks without valid pixels skipped\n", nSkipped, nBlocks);
 
-	if( poDataset->RasterIO( GF_Write, 0, 0, nXSize, nYSize, pData, nXSize, nYSize, GDT_Float32, poDataset->GetRasterCount(), NULL, 0, 0, 0) != CE_None )
+	for (int i = 0; i < nThreads; i++)
 	{
-		std::fprintf(stderr,"  writing data failed.\n\n");
-		std::exit(1);
+		delete workers[i].Grid;
+		delete workers[i].Backend;
+	}
+	delete backend;
+
+	for (int i = 0; i < nBuffers; i++)
+	{
+		CPLFree(pBuffers[i]);
+		CPLFree(pMasks[i]);
 	}
 }